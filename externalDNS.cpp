@@ -1,171 +1,2924 @@
-// Query external DNS 
-//
-// s60sc 2026
-
-#include "appGlobals.h"
-#include <lwip/netdb.h>
-#include <lwip/dns.h>
-#include <AsyncUDP.h>
-
-#define DNS_DEFAULT_PORT 53
-#define CACHE_SIZE 20 //number of previous domain names & IPs cached
-#define DEFAULT_TTL 300000 // 5 minutes in ms
-#define MAX_HOSTNAME 256
-
-/************************ DNS Receiver ***************************/
-
-AsyncUDP udp;
-
-typedef struct {
-    uint16_t id;
-    uint16_t flags;
-    uint16_t qdcount;
-    uint16_t ancount;
-    uint16_t nscount;
-    uint16_t arcount;
-} __attribute__((packed)) dns_header_t;
-
-int parseDNSname(uint8_t *packet, int offset, char *out) {
-  int i = 0;
-  while (packet[offset] != 0) {
-    int len = packet[offset++];
-    for (int j = 0; j < len; j++) out[i++] = packet[offset++];
-    out[i++] = '.';
-  }
-  out[i - 1] = '\0';
-  return offset + 1;
-}
-
-void handleDNSpacket(AsyncUDPPacket packet) {
-  uint8_t *rx = (uint8_t *)packet.data();
-  int len = packet.length();
-
-  int offset = sizeof(dns_header_t);
-  if (len < offset) return;
-  char domain[MAX_HOSTNAME];
-  int new_offset = parseDNSname(rx, offset, domain);
-  if (new_offset < 0) return;
-  offset = new_offset;
-  offset += 4; // skip QTYPE + QCLASS
-
-  // Build response
-  uint8_t tx[512];
-  memcpy(tx, rx, len);
-  dns_header_t *res = (dns_header_t *)tx;
-
-  res->flags = htons(0x8180); // response + no error
-  res->ancount = htons(1);
-  int resp_offset = offset;
-
-  // Answer: pointer to name (compression)
-  tx[resp_offset++] = 0xC0;
-  tx[resp_offset++] = 0x0C;
-
-  // Type A
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x01;
-
-  // Class IN
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x01;
-
-  // TTL
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x3C;
-
-  // Data length
-  tx[resp_offset++] = 0x00;
-  tx[resp_offset++] = 0x04;
-
-  // return IP to use
-  IPAddress gotIP = checkBlocklist(domain);
-  tx[resp_offset++] = gotIP[0];
-  tx[resp_offset++] = gotIP[1];
-  tx[resp_offset++] = gotIP[2];
-  tx[resp_offset++] = gotIP[3];
-
-  // Send response
-  packet.write(tx, resp_offset);
-}
-
-void prepDNS() {
-  if (udp.listen(DNS_DEFAULT_PORT)) {
-    LOG_INF("AdBlocker server started on port %d", DNS_DEFAULT_PORT);
-    udp.onPacket([](AsyncUDPPacket packet) { handleDNSpacket(packet); });
-    LOG_INF("DNS Server started on %s:%d", formatIPstr(), DNS_DEFAULT_PORT);
-  } else {
-    snprintf(startupFailure, SF_LEN, STARTUP_FAIL "DNS server not started");
-    LOG_WRN("%s", startupFailure);
-  }
-}
-
-/************************ DNS Forwarder **************************/
-
-struct CacheEntry {
-  char hostname[MAX_HOSTNAME] = {0};
-  IPAddress ip;
-  uint32_t expiry;
-};
-CacheEntry dnsCache[CACHE_SIZE];
-
-IPAddress resolveDomain(const char* host) {
-  // determine how to resolve received domain name
-  static int cacheIndex = 0;
-  uint16_t hostLen = strlen(host);
-  // Ignore internal discovery
-  bool isLocal = false;
-  if (strstr(host, "wpad") == host) isLocal = true;
-  if (!isLocal && hostLen >= 5 && strcmp(host + hostLen - 5, ".home") == 0) isLocal = true;
-  if (!isLocal && hostLen >= 6 && strcmp(host + hostLen - 6, ".local") == 0) isLocal = true;
-  if (isLocal) {
-    LOG_VRB("Ignore internal discovery: %s", host);
-    return IPAddress(0, 0, 0, 0); 
-  }
-
-  // Cached check
-  uint32_t now = millis();
-  for (int i = 0; i < CACHE_SIZE; i++) {
-    if (dnsCache[i].hostname[0] != '\0' && strcmp(dnsCache[i].hostname, host) == 0) {
-      if (now < dnsCache[i].expiry) {
-        LOG_VRB("Resolved %s using cache to %d.%d.%d.%d\n", host, dnsCache[i].ip[0], dnsCache[i].ip[1], dnsCache[i].ip[2], dnsCache[i].ip[3]);
-        return dnsCache[i].ip;
-      } else dnsCache[i].hostname[0] = 0; // Invalidate expired
-    }
-  }
-
-  // External DNS Lookup with Secondary Failover
-  const char* DNSserverIPs[] = {ST_ns1, ST_ns2};
-  struct addrinfo hints, *res;
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_INET;
-
-  for (int i = 0; i < 2; i++) {
-    ip_addr_t d; 
-    d.type = IPADDR_TYPE_V4;
-    ip4addr_aton(DNSserverIPs[i], &d.u_addr.ip4);
-    dns_setserver(0, &d);
-
-    uint32_t start = millis();
-    int err = getaddrinfo(host, NULL, &hints, &res);
-    uint32_t duration = millis() - start;
-
-    if (err == 0 && res != NULL) {
-      struct sockaddr_in *addr = (struct sockaddr_in *)res->ai_addr;
-      IPAddress result = IPAddress(addr->sin_addr.s_addr);
-      freeaddrinfo(res);
-      LOG_VRB("Resolved %s using %s to %d.%d.%d.%d in %lums", host, DNSserverIPs[i], result[0], result[1], result[2], result[3], duration);
-
-      // Save to local cache
-      strncpy(dnsCache[cacheIndex].hostname, host, MAX_HOSTNAME - 1);
-      dnsCache[cacheIndex].hostname[MAX_HOSTNAME - 1] = 0; // in case too long
-      dnsCache[cacheIndex].ip = result;
-      dnsCache[cacheIndex].expiry = millis() + DEFAULT_TTL;
-      cacheIndex = (cacheIndex + 1) % CACHE_SIZE;
-      return result;
-    }
-    LOG_VRB("DNS server %s unable to resolve", DNSserverIPs[i]);
-  }
-  return IPAddress(0, 0, 0, 0);
-}
+// Query external DNS
+//
+// Received DNS queries are copied into a preallocated slot by the AsyncUDP callback
+// and queued for a pool of worker tasks, pinned across both cores, which perform
+// the blocklist check, upstream lookup and reply.
+// Allowed queries are forwarded to the fastest healthy upstream DNS server and
+// the upstream response relayed to the client.
+// Queries over TCP are framed by a dedicated task and share the same worker path,
+// with responses returned out of order as each completes.
+// EDNS0 is supported, with the advertised UDP payload size configurable.
+// Upstream lookups can instead be sent over persistent DNS over TLS connections,
+// each owned by a task which pipelines queries from the workers, or over a
+// DNS over HTTPS keep-alive connection.
+//
+// s60sc 2026
+
+#include "appGlobals.h"
+#include "freertos/atomic.h"
+#include <lwip/sockets.h>
+#include <AsyncUDP.h>
+
+#define DNS_DEFAULT_PORT 53
+#define MIN_CACHE_SIZE 20 // cached responses
+#define MAX_CACHE_SIZE 4096
+#define DEFAULT_TTL 300 // max secs to cache a response
+#define MAX_HOSTNAME 256
+#define FNV_BASIS 2166136261UL
+#define FNV_PRIME 16777619UL
+#define DNS_PKT_LEN 512 // max UDP DNS message size
+#define DNS_MSG_LEN 2048 // max response relayed, eg over TCP
+#define MAX_EDNS_SIZE 1432 // max UDP payload to avoid fragmentation on 1500 byte MTU
+#define OPT_LEN 11 // OPT pseudo record without options
+#define MAX_DNS_WORKERS 8
+#define MAX_DNS_QUEUE 64
+#define MAX_TCP_CONNS 8
+#define MAX_CNAMES 8 // CNAME targets checked against blocklist per answer
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_PTR 12
+#define DNS_TYPE_MX 15
+#define DNS_TYPE_TXT 16
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_SRV 33
+#define DNS_TYPE_OPT 41
+#define DNS_TYPE_HTTPS 65
+#define DNS_FLAG_TC 0x0200 // truncated
+#define DNS_FLAG_AA 0x0400 // authoritative
+#define RCODE_FORMERR 1
+#define RCODE_SERVFAIL 2
+#define RCODE_NXDOMAIN 3
+#define RCODE_REFUSED 5
+
+// queue full policies
+enum dnsDropPolicy {DROP_NEWEST, DROP_OLDEST, DROP_REFUSE};
+// answers for blocked domains
+enum dnsBlockPolicy {BLOCK_SINKHOLE, BLOCK_NXDOMAIN, BLOCK_NODATA};
+// upstream protocols
+enum dnsUpstreamMode {UPSTREAM_UDP, UPSTREAM_TLS, UPSTREAM_HTTPS};
+
+// configurable on web page, applied on restart
+uint8_t dnsWorkers = 2; // number of DNS worker tasks
+uint8_t dnsQueueLen = 16; // number of query slots that can be queued
+uint8_t dnsDropMode = DROP_NEWEST; // action when no free slot for received query
+bool dnsRace = false; // send each query to both upstream servers and use first answer
+uint8_t dnsTcpConns = 3; // concurrent TCP client connections, applied on restart
+uint16_t dnsEdnsSize = 1232; // UDP payload size advertised with EDNS0, applied on restart
+uint8_t dnsMode = UPSTREAM_UDP; // upstream protocol, applied on restart
+char dnsTlsHost[MAX_HOST_LEN] = "one.one.one.one"; // DNS over TLS server
+uint8_t dnsTlsConns = 1; // persistent DNS over TLS connections, applied on restart
+char dnsDohUrl[IN_FILE_NAME_LEN] = "https://cloudflare-dns.com/dns-query"; // DNS over HTTPS server
+
+#if (!INCLUDE_CERTS)
+const char* dns_rootCACertificate = "";
+#endif
+uint16_t dnsCacheSize = 256; // responses cached in psram, applied on restart
+uint8_t dnsPrefetch = 10; // refresh popular cache entries in final percentage of TTL, 0 to disable
+uint16_t dnsStale = 60; // mins expired cache entries can be served if upstream unavailable, 0 to disable
+char dnsZones[IN_FILE_NAME_LEN] = "home=fwd,lan=fwd,local=nx,wpad*=nx"; // local zone actions, applied on restart
+uint16_t dnsRateLimit = 0; // max sustained queries per sec from each client, 0 to disable
+bool dnsRateRefuse = false; // reply REFUSED to rate limited query, rather than drop it
+uint8_t dnsBlockMode = BLOCK_SINKHOLE; // response to query for blocked domain
+
+// only changed by host build, to run without privileges alongside a local stub upstream
+uint16_t dnsPort = DNS_DEFAULT_PORT; // client queries
+uint16_t dnsUpstreamPort = DNS_DEFAULT_PORT; // upstream and router queries
+
+/************************ DNS Receiver ***************************/
+
+AsyncUDP udp;
+
+typedef struct {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+} __attribute__((packed)) dns_header_t;
+
+typedef struct {
+  uint8_t data[DNS_PKT_LEN]; // received query
+  uint16_t len;
+  uint32_t clientIP; // IPv4 only
+  uint16_t clientPort;
+  uint32_t queuedUs; // time slot was queued, for wait time stats
+  uint16_t qEnd; // offset following question
+  uint16_t qtype;
+  int8_t tcpConn; // index of TCP connection, or -1 if UDP
+  uint16_t tcpGen; // generation of TCP connection when query received
+  uint16_t udpSize; // max UDP response size for client
+  bool edns; // client sent OPT record, so one returned
+  uint8_t extRcode; // EDNS extended response code bits
+} dnsSlot_t;
+
+typedef struct {
+  uint16_t type;
+  uint16_t rclass; // requestor UDP payload size for OPT
+  uint32_t ttl; // extended rcode, version and flags for OPT
+  int ttlOffset; // offset of TTL field in message
+  int rdOffset; // offset of record data in message
+  uint16_t rdLen;
+} dnsRecord_t;
+
+#define PENDING_ATTACHED -1 // query attached to outstanding lookup
+#define PENDING_NONE -2 // lookup not coalesced
+
+// query log record flags
+#define QLOG_TCP 0x01
+#define QLOG_CACHED 0x02 // answered from cache
+#define QLOG_COALESCED 0x04 // answered by identical lookup in progress
+#define QLOG_CLOAKED 0x08 // blocked as CNAME target in blocklist
+
+static int matchLocalZone(const char* host);
+static void answerLocalZone(dnsSlot_t* slot, int zoneIdx, int upSock);
+static void prepZones();
+static bool answerHosts(dnsSlot_t* slot, const char* domain);
+static int cacheLookup(const char* host, uint16_t qtype, uint8_t* msg, bool allowStale = false, bool* cloaked = NULL);
+static void cacheStore(const char* host, uint16_t qtype, uint8_t* msg, int msgLen, bool cloaked);
+static int upstreamLookup(int sock, const uint8_t* query, int qEnd, uint8_t* msg);
+static int claimPending(const char* host, dnsSlot_t* slot);
+static void releasePending(int pendingIdx, uint8_t* msg, int msgLen, bool cloaked);
+static bool upstreamsDown();
+static int upstreamTcpLookup(const uint8_t* query, int qEnd, uint8_t* msg, int msgSize);
+static void tcpSend(dnsSlot_t* slot, const uint8_t* msg, int msgLen);
+static void tcpAbandon(dnsSlot_t* slot);
+static bool startDNStcp();
+static int tlsLookup(const uint8_t* query, int qEnd, uint8_t* msg);
+static bool startDNStls();
+static void updateTlsStats();
+static void prepCapture();
+static void captureQuery(const uint8_t* query, int len, uint32_t clientIP, bool isTcp);
+static void updateCaptureStats();
+static void prepQueryLog();
+static void qlogTask(void* arg);
+static void updateQueryLogStats();
+static void prepProfile();
+static void metricsQuery(uint16_t qtype, uint8_t verdict);
+static void logQuery(dnsSlot_t* slot, const char* domain, uint8_t verdict, uint8_t flags = 0);
+
+static dnsSlot_t* dnsSlots = NULL;
+static SemaphoreHandle_t cacheMutex = NULL; // cache shared by DNS workers
+static SemaphoreHandle_t hostsMutex = NULL; // held while hosts table in use, so can be replaced
+static QueueHandle_t dnsFreePool = NULL; // slots available for received queries
+static QueueHandle_t dnsQueue = NULL; // slots awaiting a worker
+
+// queue and lookup stats
+static portMUX_TYPE dnsStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t totalWaitUs = 0;
+static uint32_t maxWaitUs = 0;
+static uint32_t dequeued = 0;
+static uint32_t dnsDrops = 0;
+static UBaseType_t peakDepth = 0;
+static uint32_t upstreamCnt = 0, coalescedCnt = 0, prefetchCnt = 0;
+static uint32_t staleCnt = 0, servfailCnt = 0;
+static uint32_t hostsCnt = 0, localCnt = 0;
+static uint32_t cacheHits = 0, cacheMisses = 0;
+
+static int parseDNSname(const uint8_t *packet, int len, int offset, char *out) {
+  // extract dot separated name from DNS label sequence, return offset following name
+  int i = 0;
+  while (offset < len && packet[offset] != 0) {
+    int labelLen = packet[offset++];
+    // compression pointers not expected in question, and guard against overrun
+    if (labelLen > 63 || offset + labelLen >= len || i + labelLen + 1 >= MAX_HOSTNAME) return -1;
+    for (int j = 0; j < labelLen; j++) out[i++] = packet[offset++];
+    out[i++] = '.';
+  }
+  if (offset >= len) return -1;
+  out[i ? i - 1 : 0] = '\0';
+  return offset + 1;
+}
+
+static int writeDNSname(uint8_t* msg, int offset, const char* host) {
+  // write dot separated name as DNS label sequence, return offset following name, or 0 if invalid
+  // msg must have room for MAX_HOSTNAME bytes at offset
+  int start = offset;
+  const char* label = host;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    int labelLen = dot ? dot - label : strlen(label);
+    if (labelLen > 63 || offset - start + labelLen + 2 > MAX_HOSTNAME) return 0;
+    msg[offset++] = labelLen;
+    memcpy(msg + offset, label, labelLen);
+    offset += labelLen;
+    label += labelLen + (dot ? 1 : 0);
+  }
+  msg[offset++] = 0;
+  return offset;
+}
+
+static int skipDNSname(const uint8_t* msg, int len, int offset) {
+  // return offset following a possibly compressed name, or -1 if malformed
+  while (offset < len) {
+    uint8_t labelLen = msg[offset];
+    if (labelLen == 0) return offset + 1;
+    if ((labelLen & 0xC0) == 0xC0) return (offset + 2 <= len) ? offset + 2 : -1;
+    offset += labelLen + 1;
+  }
+  return -1;
+}
+
+static int nextRecord(const uint8_t* msg, int len, int offset, dnsRecord_t* rr) {
+  // decode resource record at offset, return offset of following record or -1 if malformed
+  offset = skipDNSname(msg, len, offset);
+  if (offset < 0 || offset + 10 > len) return -1;
+  rr->type = (msg[offset] << 8) | msg[offset + 1];
+  rr->rclass = (msg[offset + 2] << 8) | msg[offset + 3];
+  rr->ttlOffset = offset + 4;
+  rr->ttl = ((uint32_t)msg[offset + 4] << 24) | (msg[offset + 5] << 16) | (msg[offset + 6] << 8) | msg[offset + 7];
+  rr->rdLen = (msg[offset + 8] << 8) | msg[offset + 9];
+  rr->rdOffset = offset + 10;
+  if (rr->rdOffset + rr->rdLen > len) return -1;
+  return rr->rdOffset + rr->rdLen;
+}
+
+static uint32_t adjustTTLs(uint8_t* msg, int len, uint32_t ageSecs, uint32_t staleTTL = 0) {
+  // reduce record TTLs by age of cached message, and return lowest TTL
+  // expired records in a stale message are given staleTTL
+  dns_header_t* hdr = (dns_header_t*)msg;
+  int rrCount = ntohs(hdr->ancount) + ntohs(hdr->nscount) + ntohs(hdr->arcount);
+  int offset = skipDNSname(msg, len, sizeof(dns_header_t));
+  uint32_t minTTL = UINT32_MAX;
+  if (offset < 0) return 0;
+  offset += 4; // skip QTYPE + QCLASS
+  dnsRecord_t rr;
+  for (int i = 0; i < rrCount; i++) {
+    offset = nextRecord(msg, len, offset, &rr);
+    if (offset < 0) return 0;
+    if (rr.type == DNS_TYPE_OPT) continue; // TTL field holds EDNS flags
+    uint32_t ttl = rr.ttl > ageSecs ? rr.ttl - ageSecs : staleTTL;
+    if (ageSecs) {
+      msg[rr.ttlOffset] = ttl >> 24;
+      msg[rr.ttlOffset + 1] = ttl >> 16;
+      msg[rr.ttlOffset + 2] = ttl >> 8;
+      msg[rr.ttlOffset + 3] = ttl;
+    }
+    if (ttl < minTTL) minTTL = ttl;
+  }
+  return minTTL;
+}
+
+static uint32_t negativeTTL(const uint8_t* msg, int len) {
+  // TTL for negative answer, lesser of SOA record TTL and SOA MINIMUM field (RFC 2308)
+  // returns 0 if no SOA in authority section, as then should not be cached
+  dns_header_t* hdr = (dns_header_t*)msg;
+  int ancount = ntohs(hdr->ancount);
+  int rrCount = ancount + ntohs(hdr->nscount);
+  int offset = skipDNSname(msg, len, sizeof(dns_header_t));
+  if (offset < 0) return 0;
+  offset += 4; // skip QTYPE + QCLASS
+  dnsRecord_t rr;
+  for (int i = 0; i < rrCount; i++) {
+    offset = nextRecord(msg, len, offset, &rr);
+    if (offset < 0) return 0;
+    if (i >= ancount && rr.type == DNS_TYPE_SOA && rr.rdLen >= 22) {
+      const uint8_t* minField = msg + rr.rdOffset + rr.rdLen - 4;
+      uint32_t minimum = ((uint32_t)minField[0] << 24) | (minField[1] << 16) | (minField[2] << 8) | minField[3];
+      return min(rr.ttl, minimum);
+    }
+  }
+  return 0;
+}
+
+static int writeOPT(uint8_t* msg, int offset, uint8_t extRcode) {
+  // add OPT pseudo record advertising our UDP payload size, return new length
+  msg[offset++] = 0; // root name
+  msg[offset++] = DNS_TYPE_OPT >> 8;
+  msg[offset++] = DNS_TYPE_OPT & 0xFF;
+  msg[offset++] = dnsEdnsSize >> 8;
+  msg[offset++] = dnsEdnsSize & 0xFF;
+  msg[offset++] = extRcode;
+  msg[offset++] = 0; // version
+  msg[offset++] = 0; // flags
+  msg[offset++] = 0;
+  msg[offset++] = 0; // no options
+  msg[offset++] = 0;
+  return offset;
+}
+
+static int stripOPT(uint8_t* msg, int len) {
+  // remove OPT record from upstream response, as hop by hop, return new length
+  dns_header_t* hdr = (dns_header_t*)msg;
+  int anCount = ntohs(hdr->ancount) + ntohs(hdr->nscount);
+  int rrCount = anCount + ntohs(hdr->arcount);
+  int offset = skipDNSname(msg, len, sizeof(dns_header_t));
+  if (offset < 0) return len;
+  offset += 4;
+  dnsRecord_t rr;
+  for (int i = 0; i < rrCount; i++) {
+    int start = offset;
+    offset = nextRecord(msg, len, offset, &rr);
+    if (offset < 0) break;
+    if (rr.type == DNS_TYPE_OPT && i >= anCount) {
+      memmove(msg + start, msg + offset, len - offset);
+      hdr->arcount = htons(ntohs(hdr->arcount) - 1);
+      return len - (offset - start);
+    }
+  }
+  return len;
+}
+
+static bool parseEDNS(dnsSlot_t* slot) {
+  // check query for OPT record to set client's UDP payload size, return false if malformed
+  dns_header_t* hdr = (dns_header_t*)slot->data;
+  int rrCount = ntohs(hdr->ancount) + ntohs(hdr->nscount) + ntohs(hdr->arcount);
+  slot->udpSize = DNS_PKT_LEN;
+  slot->edns = false;
+  slot->extRcode = 0;
+  int offset = slot->qEnd;
+  dnsRecord_t rr;
+  for (int i = 0; i < rrCount; i++) {
+    offset = nextRecord(slot->data, slot->len, offset, &rr);
+    if (offset < 0) return false;
+    if (rr.type == DNS_TYPE_OPT) {
+      if (slot->edns) return false; // only one allowed
+      slot->edns = true;
+      slot->udpSize = constrain(rr.rclass, DNS_PKT_LEN, dnsEdnsSize);
+      if ((rr.ttl >> 16) & 0xFF) slot->extRcode = 1; // BADVERS, only version 0 supported
+    }
+  }
+  return true;
+}
+
+static IPAddress firstAddress(const uint8_t* msg, int len) {
+  // return first IPv4 address in answer section, else 0.0.0.0
+  dns_header_t* hdr = (dns_header_t*)msg;
+  int offset = skipDNSname(msg, len, sizeof(dns_header_t));
+  if (offset < 0) return IPAddress(0, 0, 0, 0);
+  offset += 4;
+  dnsRecord_t rr;
+  for (int i = 0; i < ntohs(hdr->ancount); i++) {
+    offset = nextRecord(msg, len, offset, &rr);
+    if (offset < 0) break;
+    if (rr.type == DNS_TYPE_A && rr.rdLen == 4)
+      return IPAddress(msg[rr.rdOffset], msg[rr.rdOffset + 1], msg[rr.rdOffset + 2], msg[rr.rdOffset + 3]);
+  }
+  return IPAddress(0, 0, 0, 0);
+}
+
+static int buildErrorResponse(uint8_t* tx, const uint8_t* rx, int qEnd, uint8_t rcode) {
+  // response containing only the question, with given response code
+  memcpy(tx, rx, qEnd);
+  dns_header_t *res = (dns_header_t *)tx;
+  res->flags = htons(0x8080 | (ntohs(res->flags) & 0x0100) | rcode); // response, copy RD, set RA
+  res->ancount = res->nscount = res->arcount = 0;
+  return qEnd;
+}
+
+static void sendResponse(dnsSlot_t* slot, uint8_t* msg, int msgLen) {
+  // return response to client over transport used for query, adding OPT record if client uses EDNS
+  // msg must have room for OPT record, and header is restored as may be sent to other clients
+  dns_header_t* res = (dns_header_t*)msg;
+  dns_header_t savedHdr = *res;
+  if (slot->tcpConn < 0 && msgLen + (slot->edns ? OPT_LEN : 0) > slot->udpSize) {
+    // too large for UDP, so send question only and flag as truncated for client to retry over TCP
+    res->flags |= htons(DNS_FLAG_TC);
+    res->ancount = res->nscount = res->arcount = 0;
+    msgLen = slot->qEnd;
+  }
+  if (slot->edns) {
+    msgLen = writeOPT(msg, msgLen, slot->extRcode);
+    res->arcount = htons(ntohs(res->arcount) + 1);
+  }
+  if (slot->tcpConn >= 0) tcpSend(slot, msg, msgLen);
+  else udp.writeTo(msg, msgLen, IPAddress(slot->clientIP), slot->clientPort);
+  *res = savedHdr;
+}
+
+// answer records pointing to name in question, with TTL 60 secs, followed by address
+static const uint8_t answerA[16] = {0xC0, 0x0C, 0x00, DNS_TYPE_A, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04};
+static const uint8_t answerAAAA[28] = {0xC0, 0x0C, 0x00, DNS_TYPE_AAAA, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x10};
+
+static int buildAnswer(uint8_t* tx, int offset, IPAddress gotIP) {
+  // build type A response following header and question already in tx, return length
+  dns_header_t *res = (dns_header_t *)tx;
+  res->flags = htons(0x8180); // response + no error
+  res->ancount = htons(1);
+  res->nscount = res->arcount = 0;
+  memcpy(tx + offset, answerA, sizeof(answerA));
+  for (int i = 0; i < 4; i++) tx[offset + 12 + i] = gotIP[i];
+  return offset + sizeof(answerA);
+}
+
+static int buildBlocked(uint8_t* msg, int qEnd) {
+  // turn query, or upstream answer, with question ending at qEnd into blocked response in place,
+  // according to block mode, and return its length
+  uint16_t qtype = (msg[qEnd - 4] << 8) | msg[qEnd - 3];
+  dns_header_t* res = (dns_header_t*)msg;
+  uint8_t rcode = (dnsBlockMode == BLOCK_NXDOMAIN) ? RCODE_NXDOMAIN : 0;
+  res->flags = htons(0x8080 | (ntohs(res->flags) & 0x0100) | rcode); // response, copy RD, set RA
+  res->ancount = res->nscount = res->arcount = 0;
+  if (dnsBlockMode != BLOCK_SINKHOLE) return qEnd;
+  // unspecified address for A and AAAA, no data for other types
+  if (qtype == DNS_TYPE_A) {
+    memcpy(msg + qEnd, answerA, sizeof(answerA));
+    qEnd += sizeof(answerA);
+  } else if (qtype == DNS_TYPE_AAAA) {
+    memcpy(msg + qEnd, answerAAAA, sizeof(answerAAAA));
+    qEnd += sizeof(answerAAAA);
+  } else return qEnd;
+  res->ancount = htons(1);
+  return qEnd;
+}
+
+static bool readDNSname(const uint8_t* msg, int len, int offset, char* out) {
+  // extract possibly compressed name at offset as lower case dot separated string, false if malformed
+  int i = 0, jumps = 0;
+  while (offset < len) {
+    uint8_t labelLen = msg[offset];
+    if (labelLen == 0) {
+      out[i ? i - 1 : 0] = '\0';
+      return true;
+    }
+    if ((labelLen & 0xC0) == 0xC0) {
+      // follow compression pointer, guarding against loops
+      if (offset + 1 >= len || ++jumps > 16) return false;
+      offset = ((labelLen & 0x3F) << 8) | msg[offset + 1];
+      continue;
+    }
+    if (labelLen > 63 || offset + labelLen >= len || i + labelLen + 1 >= MAX_HOSTNAME) return false;
+    for (int j = 1; j <= labelLen; j++) out[i++] = tolower(msg[offset + j]);
+    out[i++] = '.';
+    offset += labelLen + 1;
+  }
+  return false;
+}
+
+static int checkCloaking(uint8_t* msg, int msgLen, int qEnd, bool* cloaked) {
+  // check CNAME targets in upstream answer against blocklist, to detect trackers hidden
+  // behind first party names, and if any blocked replace response with blocked answer
+  *cloaked = false;
+  dns_header_t* hdr = (dns_header_t*)msg;
+  if ((ntohs(hdr->flags) & 0x000F) || !hdr->ancount) return msgLen;
+  int offset = skipDNSname(msg, msgLen, sizeof(dns_header_t));
+  if (offset < 0) return msgLen;
+  offset += 4;
+  // collect chain of names, then check in one pass
+  char nameBuf[MAX_HOSTNAME * 2];
+  const char* names[MAX_CNAMES];
+  int nameCnt = 0, bufUsed = 0;
+  dnsRecord_t rr;
+  for (int i = 0; i < ntohs(hdr->ancount) && nameCnt < MAX_CNAMES; i++) {
+    offset = nextRecord(msg, msgLen, offset, &rr);
+    if (offset < 0) break;
+    if (rr.type != DNS_TYPE_CNAME) continue;
+    char target[MAX_HOSTNAME];
+    if (!readDNSname(msg, msgLen, rr.rdOffset, target)) break;
+    int targetLen = strlen(target) + 1;
+    if (bufUsed + targetLen > (int)sizeof(nameBuf)) break;
+    names[nameCnt++] = strcpy(nameBuf + bufUsed, target);
+    bufUsed += targetLen;
+  }
+  if (!nameCnt) return msgLen;
+  int blockedIdx = checkCnameChain(names, nameCnt);
+  if (blockedIdx < 0) return msgLen;
+  LOG_VRB("Blocked CNAME %s in answer", names[blockedIdx]);
+  *cloaked = true;
+  return buildBlocked(msg, qEnd);
+}
+
+static void sendFailure(dnsSlot_t* slot) {
+  // upstream unable to resolve, so tell client rather than return misleading address
+  uint8_t tx[DNS_PKT_LEN];
+  sendResponse(slot, tx, buildErrorResponse(tx, slot->data, slot->qEnd, RCODE_SERVFAIL));
+  Atomic_Increment_u32(&servfailCnt);
+}
+
+static bool sendFormErr(dnsSlot_t* slot) {
+  // query could not be parsed, so reply with header only rather than leave client,
+  // and any TCP connection, waiting for a response
+  uint8_t tx[DNS_PKT_LEN];
+  slot->qEnd = sizeof(dns_header_t);
+  slot->edns = false;
+  slot->udpSize = DNS_PKT_LEN;
+  int len = buildErrorResponse(tx, slot->data, slot->qEnd, RCODE_FORMERR);
+  ((dns_header_t*)tx)->qdcount = 0;
+  sendResponse(slot, tx, len);
+  return true;
+}
+
+static void sendRelay(dnsSlot_t* slot, uint8_t* msg, int msgLen) {
+  // send upstream or cached response to client, using client's query id and question
+  // question section is same length as only differs by letter case
+  memcpy(msg, slot->data, sizeof(uint16_t)); // id
+  memcpy(msg + sizeof(dns_header_t), slot->data + sizeof(dns_header_t), slot->qEnd - sizeof(dns_header_t));
+  sendResponse(slot, msg, msgLen);
+}
+
+static bool handleDNSpacket(dnsSlot_t* slot, int upSock) {
+  // process query held in slot and send response to client
+  // returns false if slot attached to an outstanding lookup, to be answered later
+  uint8_t *rx = slot->data;
+  int len = slot->len;
+
+  // queries shorter than header rejected when received
+  int offset = sizeof(dns_header_t);
+  char domain[MAX_HOSTNAME];
+  int new_offset = parseDNSname(rx, len, offset, domain);
+  if (new_offset < 0) return sendFormErr(slot);
+  offset = new_offset;
+  if (offset + 4 > len) return sendFormErr(slot);
+  slot->qtype = (rx[offset] << 8) | rx[offset + 1];
+  offset += 4; // skip QTYPE + QCLASS
+  slot->qEnd = offset;
+  if (!parseEDNS(slot)) return sendFormErr(slot);
+
+  int zoneIdx;
+  if (slot->extRcode) {
+    uint8_t tx[DNS_PKT_LEN];
+    sendResponse(slot, tx, buildErrorResponse(tx, rx, slot->qEnd, 0)); // unsupported EDNS version
+    logQuery(slot, domain, VERDICT_ERROR);
+  } else if (answerHosts(slot, domain)) logQuery(slot, domain, VERDICT_LOCAL);
+  else if ((zoneIdx = matchLocalZone(domain)) >= 0) {
+    answerLocalZone(slot, zoneIdx, upSock);
+    logQuery(slot, domain, VERDICT_LOCAL);
+  } else if (checkBlocklist(domain, slot->clientIP)) {
+    sendResponse(slot, rx, buildBlocked(rx, slot->qEnd)); // in place
+    logQuery(slot, domain, VERDICT_BLOCKED);
+  } else {
+    uint8_t msg[DNS_MSG_LEN];
+    bool cloaked = false; // answer replaced by blocked answer
+    int msgLen = cacheLookup(domain, slot->qtype, msg, false, &cloaked);
+    Atomic_Increment_u32(msgLen ? &cacheHits : &cacheMisses);
+    uint8_t logFlags = msgLen ? QLOG_CACHED : 0;
+    // if upstreams known to be down, answer from stale cache without waiting for timeout
+    if (!msgLen && upstreamsDown()) msgLen = cacheLookup(domain, slot->qtype, msg, true, &cloaked);
+    if (!msgLen) {
+      // need upstream lookup, unless identical query already in progress
+      // TCP queries not coalesced as may need larger response than UDP
+      int pendingIdx = slot->tcpConn < 0 ? claimPending(domain, slot) : PENDING_NONE;
+      if (pendingIdx == PENDING_ATTACHED) return false; // answered and logged when lookup in progress completes
+      msgLen = upstreamLookup(upSock, rx, slot->qEnd, msg);
+      // truncated upstream answer is retried over TCP for TCP client
+      if (msgLen && slot->tcpConn >= 0 && (ntohs(((dns_header_t*)msg)->flags) & DNS_FLAG_TC))
+        msgLen = upstreamTcpLookup(rx, slot->qEnd, msg, sizeof(msg) - OPT_LEN);
+      if (msgLen) {
+        msgLen = checkCloaking(msg, msgLen, slot->qEnd, &cloaked);
+        cacheStore(domain, slot->qtype, msg, msgLen, cloaked);
+      }
+      else msgLen = cacheLookup(domain, slot->qtype, msg, true, &cloaked);
+      if (pendingIdx >= 0) releasePending(pendingIdx, msg, msgLen, cloaked);
+    }
+    if (msgLen) sendRelay(slot, msg, msgLen);
+    else sendFailure(slot);
+    logQuery(slot, domain, !msgLen ? VERDICT_ERROR : cloaked ? VERDICT_BLOCKED : VERDICT_ALLOWED,
+      logFlags | (cloaked ? QLOG_CLOAKED : 0));
+  }
+  return true;
+}
+
+/*********************** Rate Limiting ***************************/
+
+// token bucket per client in fixed size hash table, so that a client flooding
+// queries cannot starve others, at constant cost per packet
+
+#define RATE_BUCKET_BITS 6
+#define RATE_BUCKETS (1 << RATE_BUCKET_BITS) // clients tracked
+#define RATE_PROBES 4 // buckets searched for client before replacing least recently seen
+#define RATE_BURST 2 // secs of queries at limit allowed as a burst
+#define RATE_TOP 3 // top offenders shown on web page
+
+struct RateBucket {
+  uint32_t clientIP; // 0 if unused
+  uint32_t lastMs;
+  uint32_t tokens; // thousandths of a query
+  uint32_t limited; // queries refused or dropped
+};
+static RateBucket rateBuckets[RATE_BUCKETS];
+static portMUX_TYPE rateMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t rateLimitedCnt = 0;
+
+static bool rateLimited(uint32_t clientIP) {
+  // take token from client bucket, refilled at dnsRateLimit per sec, return true if none available
+  if (!dnsRateLimit) return false;
+  uint32_t now = millis();
+  uint32_t maxTokens = dnsRateLimit * RATE_BURST * 1000;
+  uint32_t idx = (clientIP * 2654435761UL) >> (32 - RATE_BUCKET_BITS); // multiplicative hash
+  taskENTER_CRITICAL(&rateMux);
+  RateBucket* rb = NULL;
+  RateBucket* oldest = NULL;
+  for (int i = 0; i < RATE_PROBES; i++) {
+    RateBucket* probe = rateBuckets + ((idx + i) & (RATE_BUCKETS - 1));
+    if (probe->clientIP == clientIP) {
+      rb = probe;
+      break;
+    }
+    if (oldest == NULL || !probe->clientIP || (oldest->clientIP && (int32_t)(probe->lastMs - oldest->lastMs) < 0))
+      oldest = probe;
+  }
+  if (rb == NULL) {
+    // new client starts with full bucket
+    rb = oldest;
+    rb->clientIP = clientIP;
+    rb->tokens = maxTokens;
+    rb->limited = 0;
+  } else {
+    uint32_t elapsed = min(now - rb->lastMs, (uint32_t)RATE_BURST * 1000);
+    rb->tokens = min(rb->tokens + elapsed * dnsRateLimit, maxTokens);
+  }
+  rb->lastMs = now;
+  bool isLimited = rb->tokens < 1000;
+  if (isLimited) {
+    rb->limited++;
+    rateLimitedCnt++;
+  } else rb->tokens -= 1000;
+  taskEXIT_CRITICAL(&rateMux);
+  return isLimited;
+}
+
+static void updateRateStats() {
+  // show total rate limited queries and clients with most limited
+  RateBucket top[RATE_TOP] = {};
+  taskENTER_CRITICAL(&rateMux);
+  uint32_t total = rateLimitedCnt;
+  for (int i = 0; i < RATE_BUCKETS; i++) {
+    RateBucket* rb = rateBuckets + i;
+    int pos = RATE_TOP;
+    while (pos > 0 && rb->limited > top[pos - 1].limited) pos--;
+    if (pos == RATE_TOP) continue;
+    memmove(top + pos + 1, top + pos, (RATE_TOP - pos - 1) * sizeof(RateBucket));
+    top[pos] = *rb;
+  }
+  taskEXIT_CRITICAL(&rateMux);
+  char statsStr[IN_FILE_NAME_LEN];
+  int pos = snprintf(statsStr, sizeof(statsStr), "%lu", total);
+  for (int i = 0; i < RATE_TOP && top[i].limited && pos < (int)sizeof(statsStr); i++)
+    pos += snprintf(statsStr + pos, sizeof(statsStr) - pos, "%s %s (%lu)", i ? "," : ":",
+      IPAddress(top[i].clientIP).toString().c_str(), top[i].limited);
+  updateConfigVect("dnsLimited", statsStr);
+}
+
+static void refuseDNSpacket(AsyncUDPPacket& packet) {
+  // queue full or client rate limited, so tell client to try elsewhere rather than wait for timeout
+  const uint8_t* rx = packet.data();
+  int len = packet.length();
+  char domain[MAX_HOSTNAME];
+  int qEnd = parseDNSname(rx, len, sizeof(dns_header_t), domain);
+  if (qEnd < 0 || qEnd + 4 > len) return;
+  uint8_t tx[DNS_PKT_LEN];
+  packet.write(tx, buildErrorResponse(tx, rx, qEnd + 4, RCODE_REFUSED));
+}
+
+static void queueDNSpacket(AsyncUDPPacket& packet) {
+  // called in AsyncUDP task context, so only copy query into a free slot for a worker
+  if (packet.length() < sizeof(dns_header_t) || packet.length() > DNS_PKT_LEN) return;
+  captureQuery(packet.data(), packet.length(), (uint32_t)packet.remoteIP(), false);
+  if (rateLimited((uint32_t)packet.remoteIP())) {
+    if (dnsRateRefuse) refuseDNSpacket(packet);
+    return;
+  }
+  dnsSlot_t* slot = NULL;
+  if (xQueueReceive(dnsFreePool, &slot, 0) != pdTRUE) {
+    // no free slot, apply drop policy
+    Atomic_Increment_u32(&dnsDrops);
+    if (dnsDropMode == DROP_OLDEST && xQueueReceive(dnsQueue, &slot, 0) == pdTRUE) {
+      // abandon oldest waiting query and reuse its slot
+      if (slot->tcpConn >= 0) tcpAbandon(slot);
+    } else {
+      if (dnsDropMode == DROP_REFUSE) refuseDNSpacket(packet);
+      return;
+    }
+  }
+  memcpy(slot->data, packet.data(), packet.length());
+  slot->len = packet.length();
+  slot->clientIP = (uint32_t)packet.remoteIP();
+  slot->clientPort = packet.remotePort();
+  slot->tcpConn = -1;
+  slot->queuedUs = micros();
+  xQueueSend(dnsQueue, &slot, 0); // always space as queue depth matches slot count
+  UBaseType_t depth = uxQueueMessagesWaiting(dnsQueue);
+  if (depth > peakDepth) peakDepth = depth;
+}
+
+static void dnsWorkerTask(void* arg) {
+  // take next queued query, resolve it and reply
+  dnsSlot_t* slot;
+  // each worker has own socket for upstream queries
+  int upSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (upSock < 0) LOG_ERR("Failed to create upstream socket, errno %d", errno);
+  while (true) {
+    if (xQueueReceive(dnsQueue, &slot, portMAX_DELAY) == pdTRUE) {
+      uint32_t waitUs = micros() - slot->queuedUs;
+      taskENTER_CRITICAL(&dnsStatsMux);
+      totalWaitUs += waitUs;
+      if (waitUs > maxWaitUs) maxWaitUs = waitUs;
+      dequeued++;
+      taskEXIT_CRITICAL(&dnsStatsMux);
+      metricsObserve(HIST_QUEUE_WAIT, waitUs);
+      if (handleDNSpacket(slot, upSock)) xQueueSend(dnsFreePool, &slot, portMAX_DELAY);
+    }
+  }
+}
+
+static void updateUpstreamStats();
+static void updateTcpStats();
+
+void updateDNSstats() {
+  // format queue stats for display on web page
+  char statsStr[FILE_NAME_LEN];
+  taskENTER_CRITICAL(&dnsStatsMux);
+  uint32_t avgWaitUs = dequeued ? totalWaitUs / dequeued : 0;
+  uint32_t worstUs = maxWaitUs;
+  maxWaitUs = 0; // max since last report
+  taskEXIT_CRITICAL(&dnsStatsMux);
+  snprintf(statsStr, sizeof(statsStr), "%luus/%luus %u/%u %lu", avgWaitUs, worstUs,
+    peakDepth, dnsQueueLen, dnsDrops);
+  updateConfigVect("dnsQueue", statsStr);
+  snprintf(statsStr, sizeof(statsStr), "%lu / %lu / %lu", upstreamCnt, coalescedCnt, prefetchCnt);
+  updateConfigVect("dnsLookups", statsStr);
+  snprintf(statsStr, sizeof(statsStr), "%lu / %lu", staleCnt, servfailCnt);
+  updateConfigVect("dnsFailed", statsStr);
+  snprintf(statsStr, sizeof(statsStr), "%lu / %lu", hostsCnt, localCnt);
+  updateConfigVect("dnsLocal", statsStr);
+  updateRateStats();
+  updateUpstreamStats();
+  updateTcpStats();
+  updateTlsStats();
+  updateCaptureStats();
+  updateQueryLogStats();
+}
+
+static bool prepUpstreams();
+static bool prepCache();
+static void prefetchTask(void* arg);
+
+static bool startDNSworkers() {
+  // allocate query slots and start worker pool
+  dnsWorkers = constrain(dnsWorkers, 1, MAX_DNS_WORKERS);
+  dnsQueueLen = constrain(dnsQueueLen, dnsWorkers, MAX_DNS_QUEUE);
+  dnsEdnsSize = constrain(dnsEdnsSize, DNS_PKT_LEN, MAX_EDNS_SIZE);
+  // prefer internal ram for hot path copy
+  dnsSlots = (dnsSlot_t*)heap_caps_malloc(dnsQueueLen * sizeof(dnsSlot_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (dnsSlots == NULL) dnsSlots = (dnsSlot_t*)ps_malloc(dnsQueueLen * sizeof(dnsSlot_t));
+  dnsFreePool = xQueueCreate(dnsQueueLen, sizeof(dnsSlot_t*));
+  dnsQueue = xQueueCreate(dnsQueueLen, sizeof(dnsSlot_t*));
+  cacheMutex = xSemaphoreCreateMutex();
+  hostsMutex = xSemaphoreCreateMutex();
+  if (dnsSlots == NULL || dnsFreePool == NULL || dnsQueue == NULL || cacheMutex == NULL || hostsMutex == NULL) return false;
+  if (!prepCache() || !prepUpstreams()) return false;
+  prepZones();
+  loadHosts();
+  prepCapture();
+  prepQueryLog();
+  prepProfile();
+  if (dnsMode != UPSTREAM_UDP && !startDNStls()) return false;
+  for (int i = 0; i < dnsQueueLen; i++) {
+    dnsSlot_t* slot = dnsSlots + i;
+    xQueueSend(dnsFreePool, &slot, 0);
+  }
+  for (int i = 0; i < dnsWorkers; i++) {
+    char taskName[16];
+    snprintf(taskName, sizeof(taskName), "dnsWorker%d", i);
+    xTaskCreatePinnedToCoreWithCaps(dnsWorkerTask, taskName, DNS_STACK_SIZE, NULL, DNS_PRI, NULL,
+      i % CONFIG_FREERTOS_NUMBER_OF_CORES, STACK_MEM);
+  }
+  xTaskCreateWithCaps(prefetchTask, "dnsPrefetch", DNS_STACK_SIZE, NULL, DNS_PRI - 1, NULL, STACK_MEM);
+  LOG_INF("Started %u DNS workers with queue depth %u", dnsWorkers, dnsQueueLen);
+  return true;
+}
+
+void prepDNS() {
+  if (!startDNSworkers()) {
+    snprintf(startupFailure, SF_LEN, STARTUP_FAIL "DNS workers not started");
+    LOG_WRN("%s", startupFailure);
+  } else if (udp.listen(dnsPort)) {
+    LOG_INF("AdBlocker server started on port %u", dnsPort);
+    udp.onPacket([](AsyncUDPPacket packet) { queueDNSpacket(packet); });
+    LOG_INF("DNS Server started on %s:%u", formatIPstr(), dnsPort);
+    if (!startDNStcp()) LOG_WRN("DNS TCP listener not started");
+  } else {
+    snprintf(startupFailure, SF_LEN, STARTUP_FAIL "DNS server not started");
+    LOG_WRN("%s", startupFailure);
+  }
+}
+
+/*********************** DNS TCP Listener ************************/
+
+#define TCP_IDLE_TIMEOUT 10000 // ms before idle connection closed
+#define TCP_SEND_TIMEOUT 2000 // ms to wait for client to accept response
+#define TCP_SLOT_WAIT 100 // ms to wait for a free query slot
+
+// client TCP connection, with multiple queries framed by 2 byte length prefix
+struct TcpConn {
+  int sock; // -1 if unused
+  uint16_t gen; // incremented on close so late responses are discarded
+  uint8_t rx[2 + DNS_PKT_LEN]; // partially received query
+  uint16_t rxLen;
+  uint32_t lastActive; // ms
+  uint16_t inflight; // queries being processed
+  uint32_t clientIP;
+  uint16_t clientPort;
+  SemaphoreHandle_t sendMutex; // workers respond out of order
+};
+static TcpConn* tcpConns = NULL;
+static uint32_t tcpQueries = 0, tcpRejects = 0;
+
+static void tcpClose(TcpConn* conn) {
+  xSemaphoreTake(conn->sendMutex, portMAX_DELAY);
+  close(conn->sock);
+  conn->sock = -1;
+  conn->gen++;
+  conn->rxLen = 0;
+  xSemaphoreGive(conn->sendMutex);
+}
+
+static void tcpSend(dnsSlot_t* slot, const uint8_t* msg, int msgLen) {
+  // send length prefixed response, unless connection since closed
+  TcpConn* conn = tcpConns + slot->tcpConn;
+  uint8_t prefix[2] = {(uint8_t)(msgLen >> 8), (uint8_t)msgLen};
+  xSemaphoreTake(conn->sendMutex, portMAX_DELAY);
+  if (conn->gen == slot->tcpGen && conn->sock >= 0) {
+    if (send(conn->sock, prefix, 2, MSG_MORE) != 2 || send(conn->sock, msg, msgLen, 0) != msgLen)
+      LOG_VRB("Failed to send TCP response, errno %d", errno);
+    conn->lastActive = millis();
+    conn->inflight--;
+  }
+  xSemaphoreGive(conn->sendMutex);
+}
+
+static void tcpAbandon(dnsSlot_t* slot) {
+  // query dropped without response
+  TcpConn* conn = tcpConns + slot->tcpConn;
+  xSemaphoreTake(conn->sendMutex, portMAX_DELAY);
+  if (conn->gen == slot->tcpGen) conn->inflight--;
+  xSemaphoreGive(conn->sendMutex);
+}
+
+static void tcpRefuse(TcpConn* conn, const uint8_t* query, int queryLen) {
+  // queue full or client rate limited, so tell client to try elsewhere rather than wait for timeout
+  char domain[MAX_HOSTNAME];
+  int qEnd = parseDNSname(query, queryLen, sizeof(dns_header_t), domain);
+  if (qEnd < 0 || qEnd + 4 > queryLen) return;
+  uint8_t tx[DNS_PKT_LEN];
+  int msgLen = buildErrorResponse(tx, query, qEnd + 4, RCODE_REFUSED);
+  uint8_t prefix[2] = {(uint8_t)(msgLen >> 8), (uint8_t)msgLen};
+  xSemaphoreTake(conn->sendMutex, portMAX_DELAY);
+  if (send(conn->sock, prefix, 2, MSG_MORE) != 2 || send(conn->sock, tx, msgLen, 0) != msgLen)
+    LOG_VRB("Failed to send TCP response, errno %d", errno);
+  conn->lastActive = millis();
+  xSemaphoreGive(conn->sendMutex);
+}
+
+static void tcpQueueQuery(int connIdx, const uint8_t* query, int queryLen) {
+  // pass framed query to DNS workers, waiting briefly for a free slot
+  TcpConn* conn = tcpConns + connIdx;
+  captureQuery(query, queryLen, conn->clientIP, true);
+  // pipelined queries share client bucket with its UDP queries
+  if (rateLimited(conn->clientIP)) {
+    if (dnsRateRefuse) tcpRefuse(conn, query, queryLen);
+    return;
+  }
+  dnsSlot_t* slot = NULL;
+  if (xQueueReceive(dnsFreePool, &slot, pdMS_TO_TICKS(TCP_SLOT_WAIT)) != pdTRUE) {
+    Atomic_Increment_u32(&dnsDrops);
+    tcpRefuse(conn, query, queryLen);
+    return;
+  }
+  memcpy(slot->data, query, queryLen);
+  slot->len = queryLen;
+  slot->clientIP = conn->clientIP;
+  slot->clientPort = conn->clientPort;
+  slot->tcpConn = connIdx;
+  slot->tcpGen = conn->gen;
+  slot->queuedUs = micros();
+  xSemaphoreTake(conn->sendMutex, portMAX_DELAY);
+  conn->inflight++;
+  xSemaphoreGive(conn->sendMutex);
+  tcpQueries++;
+  xQueueSend(dnsQueue, &slot, 0);
+}
+
+static bool tcpReceive(int connIdx) {
+  // read available data and queue each complete query, return false if connection to be closed
+  TcpConn* conn = tcpConns + connIdx;
+  int got = recv(conn->sock, conn->rx + conn->rxLen, sizeof(conn->rx) - conn->rxLen, 0);
+  if (got <= 0) return false; // closed by client or error
+  conn->rxLen += got;
+  conn->lastActive = millis();
+  // multiple pipelined queries may have been received
+  while (conn->rxLen >= 2) {
+    int queryLen = (conn->rx[0] << 8) | conn->rx[1];
+    if (queryLen < (int)sizeof(dns_header_t) || queryLen > DNS_PKT_LEN) return false; // invalid framing
+    if (conn->rxLen < queryLen + 2) break; // wait for rest of query
+    tcpQueueQuery(connIdx, conn->rx + 2, queryLen);
+    conn->rxLen -= queryLen + 2;
+    memmove(conn->rx, conn->rx + queryLen + 2, conn->rxLen);
+  }
+  return true;
+}
+
+static void tcpAccept(int listenSock) {
+  // accept new client connection if below connection limit
+  struct sockaddr_in client;
+  socklen_t clientLen = sizeof(client);
+  int sock = accept(listenSock, (struct sockaddr*)&client, &clientLen);
+  if (sock < 0) return;
+  for (int i = 0; i < dnsTcpConns; i++) {
+    TcpConn* conn = tcpConns + i;
+    if (conn->sock < 0) {
+      struct timeval tv = {TCP_SEND_TIMEOUT / 1000, (TCP_SEND_TIMEOUT % 1000) * 1000};
+      setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+      int noDelay = 1;
+      setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      conn->clientIP = client.sin_addr.s_addr;
+      conn->clientPort = ntohs(client.sin_port);
+      conn->rxLen = 0;
+      conn->inflight = 0;
+      conn->lastActive = millis();
+      conn->sock = sock;
+      return;
+    }
+  }
+  // at connection limit
+  close(sock);
+  tcpRejects++;
+}
+
+static void dnsTcpTask(void* listenPtr) {
+  // service TCP listener and client connections
+  int listenSock = (intptr_t)listenPtr;
+  while (true) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(listenSock, &readSet);
+    int maxSock = listenSock;
+    for (int i = 0; i < dnsTcpConns; i++) {
+      if (tcpConns[i].sock >= 0) {
+        FD_SET(tcpConns[i].sock, &readSet);
+        maxSock = max(maxSock, tcpConns[i].sock);
+      }
+    }
+    struct timeval tv = {1, 0};
+    int ready = select(maxSock + 1, &readSet, NULL, NULL, &tv);
+    if (ready > 0 && FD_ISSET(listenSock, &readSet)) tcpAccept(listenSock);
+    uint32_t now = millis();
+    for (int i = 0; i < dnsTcpConns; i++) {
+      TcpConn* conn = tcpConns + i;
+      if (conn->sock < 0) continue;
+      if (ready > 0 && FD_ISSET(conn->sock, &readSet)) {
+        if (!tcpReceive(i)) tcpClose(conn);
+      } else if (!conn->inflight && now - conn->lastActive > TCP_IDLE_TIMEOUT) tcpClose(conn);
+    }
+  }
+}
+
+static bool startDNStcp() {
+  // listen for DNS queries over TCP
+  dnsTcpConns = constrain(dnsTcpConns, 0, MAX_TCP_CONNS);
+  if (!dnsTcpConns) return true; // disabled
+  tcpConns = (TcpConn*)ps_malloc(dnsTcpConns * sizeof(TcpConn));
+  if (tcpConns == NULL) return false;
+  for (int i = 0; i < dnsTcpConns; i++) {
+    tcpConns[i].sock = -1;
+    tcpConns[i].gen = 0;
+    tcpConns[i].inflight = 0;
+    tcpConns[i].sendMutex = xSemaphoreCreateMutex();
+    if (tcpConns[i].sendMutex == NULL) return false;
+  }
+  int listenSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listenSock < 0) return false;
+  int reuse = 1;
+  setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(dnsPort);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(listenSock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenSock, 2) < 0) {
+    close(listenSock);
+    return false;
+  }
+  xTaskCreateWithCaps(dnsTcpTask, "dnsTcp", DNS_STACK_SIZE, (void*)(intptr_t)listenSock, DNS_PRI, NULL, STACK_MEM);
+  LOG_INF("DNS TCP listener started for %u connections", dnsTcpConns);
+  return true;
+}
+
+static void updateTcpStats() {
+  // TCP connections in use and queries received
+  char statsStr[FILE_NAME_LEN];
+  int active = 0;
+  for (int i = 0; i < dnsTcpConns; i++) if (tcpConns[i].sock >= 0) active++;
+  snprintf(statsStr, sizeof(statsStr), "%d/%u %lu %lu", active, dnsTcpConns, tcpQueries, tcpRejects);
+  updateConfigVect("dnsTcp", statsStr);
+}
+
+/************************ DNS Forwarder **************************/
+
+#define MAX_PENDING 8 // concurrent upstream lookups that can be coalesced
+#define MAX_WAITERS 8 // identical queries that can attach to each lookup
+#define NUM_UPSTREAMS 2
+#define UPSTREAM_TIMEOUT 2000 // ms to wait for any upstream answer
+#define UPSTREAM_MIN_WAIT 50 // ms to wait before also trying next upstream
+#define UPSTREAM_MAX_FAIL 3 // consecutive failures before upstream treated as down
+#define UPSTREAM_RETRY 30000 // ms before a down upstream is tried again
+#define RTT_ALPHA 0.125 // smoothing factor for round trip time
+#define PREFETCH_MIN_HITS 3 // cache hits since last refresh for entry to be prefetched
+#define PREFETCH_MAX_RATE 4 // max prefetch lookups per second
+#define STALE_TTL 30 // secs TTL given to stale answers (RFC 8767)
+#define STALE_RECHECK 30000 // ms before failed refresh of stale entry retried
+#define MAX_STALE_MINS (7 * 24 * 60)
+
+struct CacheEntry {
+  char hostname[MAX_HOSTNAME]; // empty if unused
+  uint32_t hash; // of hostname, checked before comparing names
+  uint16_t qtype;
+  uint16_t len;
+  uint32_t stored; // ms
+  uint32_t expiry; // ms
+  uint32_t used; // ms when last stored or returned, for least recently used eviction
+  uint16_t hits; // since stored
+  bool prefetching;
+  bool cloaked; // msg is blocked answer replacing upstream response
+  bool stale; // served after expiry, so needs refresh
+  uint32_t refreshTime; // ms when refresh can next be attempted
+  uint8_t* msg; // upstream response
+};
+static CacheEntry* dnsCache = NULL; // dnsCacheSize entries
+
+// upstream lookups in progress, identical queries are attached rather than sent upstream
+struct PendingQuery {
+  char hostname[MAX_HOSTNAME];
+  uint16_t qtype;
+  bool active;
+  uint8_t waitCnt;
+  dnsSlot_t* waiters[MAX_WAITERS];
+};
+static PendingQuery pendingQueries[MAX_PENDING];
+
+// upstream DNS servers, selected by smoothed round trip time and health
+struct Upstream {
+  const char* ip; // from config
+  struct sockaddr_in addr;
+  bool valid;
+  float srtt; // smoothed round trip time in ms, 0 if not yet measured
+  uint32_t queries;
+  uint32_t errors; // timeouts and failure responses
+  uint8_t consecFails;
+  uint32_t retryTime; // ms when down upstream can be tried again
+};
+static Upstream upstreams[NUM_UPSTREAMS] = {{ST_ns1}, {ST_ns2}};
+static portMUX_TYPE upstreamMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool prepCache() {
+  // cached responses held in psram, each sized for largest UDP response
+  // if insufficient memory for configured size, halve it
+  dnsCacheSize = constrain(dnsCacheSize, MIN_CACHE_SIZE, MAX_CACHE_SIZE);
+  uint8_t* cacheMem = NULL;
+  while (true) {
+    dnsCache = (CacheEntry*)ps_calloc(dnsCacheSize, sizeof(CacheEntry));
+    cacheMem = (uint8_t*)ps_malloc(dnsCacheSize * dnsEdnsSize);
+    if (dnsCache != NULL && cacheMem != NULL) break;
+    free(dnsCache);
+    free(cacheMem);
+    if (dnsCacheSize == MIN_CACHE_SIZE) return false;
+    dnsCacheSize = max(dnsCacheSize / 2, MIN_CACHE_SIZE);
+    LOG_WRN("Insufficient memory for DNS cache, reduced to %u entries", dnsCacheSize);
+  }
+  for (int i = 0; i < dnsCacheSize; i++) dnsCache[i].msg = cacheMem + (i * dnsEdnsSize);
+  LOG_INF("DNS cache of %u entries using %s", dnsCacheSize, fmtSize(dnsCacheSize * (sizeof(CacheEntry) + dnsEdnsSize)));
+  return true;
+}
+
+static uint32_t cacheHash(const char* host, uint16_t qtype) {
+  // FNV-1a of name and type
+  uint32_t hash = FNV_BASIS ^ qtype;
+  while (*host) hash = (hash ^ (uint8_t)*host++) * FNV_PRIME;
+  return hash;
+}
+
+static int cacheLookup(const char* host, uint16_t qtype, uint8_t* msg, bool allowStale, bool* cloaked) {
+  // Cached check, copy cached response into msg and return its length
+  // expired entries are kept for stale window, and only returned if allowStale
+  // cloaked set if response is blocked answer for CNAME target in blocklist
+  uint32_t now = millis();
+  int32_t staleMs = min(dnsStale, (uint16_t)MAX_STALE_MINS) * 60000;
+  uint32_t hash = cacheHash(host, qtype);
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  for (int i = 0; i < dnsCacheSize; i++) {
+    CacheEntry* ce = dnsCache + i;
+    if (ce->hash == hash && ce->hostname[0] != '\0' && ce->qtype == qtype && strcmp(ce->hostname, host) == 0) {
+      int32_t remaining = (int32_t)(ce->expiry - now);
+      if (remaining > 0 || (allowStale && remaining > -staleMs)) {
+        int msgLen = ce->len;
+        memcpy(msg, ce->msg, msgLen);
+        if (ce->hits < UINT16_MAX) ce->hits++;
+        ce->used = now;
+        bool isStale = remaining <= 0;
+        if (isStale) ce->stale = true; // for background refresh
+        if (cloaked != NULL) *cloaked = ce->cloaked;
+        uint32_t ageSecs = (now - ce->stored) / 1000;
+        xSemaphoreGive(cacheMutex);
+        adjustTTLs(msg, msgLen, ageSecs, isStale ? STALE_TTL : 0);
+        if (isStale) {
+          Atomic_Increment_u32(&staleCnt);
+          LOG_VRB("Resolved %s type %u using stale cache", host, qtype);
+        } else LOG_VRB("Resolved %s type %u using %s cache", host, qtype,
+          ((dns_header_t*)msg)->ancount ? "positive" : "negative");
+        return msgLen;
+      } else if (remaining <= -staleMs) ce->hostname[0] = 0; // Invalidate expired
+    }
+  }
+  xSemaphoreGive(cacheMutex);
+  return 0;
+}
+
+static void cacheStore(const char* host, uint16_t qtype, uint8_t* msg, int msgLen, bool cloaked) {
+  // Save successful answer to local cache for lowest record TTL,
+  // or NXDOMAIN / NODATA answer for TTL given by its SOA record
+  dns_header_t* hdr = (dns_header_t*)msg;
+  uint16_t flags = ntohs(hdr->flags);
+  uint8_t rcode = flags & 0x000F;
+  if ((flags & DNS_FLAG_TC) || msgLen > dnsEdnsSize) return; // incomplete or too large for cache entry
+  uint32_t ttl;
+  if (rcode == 0 && hdr->ancount) ttl = adjustTTLs(msg, msgLen, 0);
+  else if (rcode == RCODE_NXDOMAIN || rcode == 0) ttl = negativeTTL(msg, msgLen);
+  else return; // failure
+  ttl = min(ttl, (uint32_t)DEFAULT_TTL);
+  if (!ttl) return;
+  uint32_t hash = cacheHash(host, qtype);
+  uint32_t now = millis();
+  int32_t staleMs = min(dnsStale, (uint16_t)MAX_STALE_MINS) * 60000;
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  // replace existing entry for same name, eg when prefetched, else use an unused or
+  // expired entry, else evict least recently used, so popular entries stay for prefetch
+  CacheEntry* ce = NULL;
+  CacheEntry* victim = dnsCache;
+  bool victimFree = false;
+  for (int i = 0; i < dnsCacheSize; i++) {
+    CacheEntry* entry = dnsCache + i;
+    if (entry->hash == hash && entry->qtype == qtype && strcmp(entry->hostname, host) == 0) {
+      ce = entry;
+      break;
+    }
+    if (victimFree) continue;
+    if (entry->hostname[0] == '\0' || (int32_t)(entry->expiry - now) <= -staleMs) {
+      victim = entry;
+      victimFree = true;
+    } else if ((int32_t)(entry->used - victim->used) < 0 && !entry->prefetching) victim = entry;
+  }
+  if (ce == NULL) ce = victim;
+  strncpy(ce->hostname, host, MAX_HOSTNAME - 1);
+  ce->hostname[MAX_HOSTNAME - 1] = 0; // in case too long
+  ce->qtype = qtype;
+  ce->len = msgLen;
+  memcpy(ce->msg, msg, msgLen);
+  ce->hash = hash;
+  ce->stored = ce->used = now;
+  ce->expiry = ce->stored + (ttl * 1000);
+  ce->hits = 0;
+  ce->cloaked = cloaked;
+  ce->prefetching = ce->stale = false;
+  ce->refreshTime = ce->stored;
+  xSemaphoreGive(cacheMutex);
+}
+
+static int buildQuery(uint8_t* query, const char* host, uint16_t qtype);
+
+static void prefetchTask(void* arg) {
+  // refresh popular cache entries nearing expiry, so that they are not missed by clients,
+  // and stale entries that have been served while upstream unavailable
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) LOG_ERR("Failed to create prefetch socket, errno %d", errno);
+  while (sock >= 0) {
+    delay(1000);
+    // select entries under mutex, then look up outside it
+    char host[MAX_HOSTNAME];
+    for (int i = 0; i < PREFETCH_MAX_RATE; i++) {
+      uint16_t qtype = 0;
+      uint32_t now = millis();
+      xSemaphoreTake(cacheMutex, portMAX_DELAY);
+      for (int j = 0; j < dnsCacheSize; j++) {
+        CacheEntry* ce = dnsCache + j;
+        int32_t remaining = (int32_t)(ce->expiry - now);
+        uint32_t window = (ce->expiry - ce->stored) / 100 * min(dnsPrefetch, (uint8_t)100);
+        bool isDue = ce->stale || (ce->hits >= PREFETCH_MIN_HITS && remaining > 0 && remaining < (int32_t)window);
+        if (ce->hostname[0] != '\0' && !ce->prefetching && isDue && (int32_t)(now - ce->refreshTime) >= 0) {
+          ce->prefetching = true;
+          strcpy(host, ce->hostname);
+          qtype = ce->qtype;
+          break;
+        }
+      }
+      xSemaphoreGive(cacheMutex);
+      if (!qtype) break; // nothing due
+
+      uint8_t query[DNS_PKT_LEN];
+      uint8_t msg[DNS_MSG_LEN];
+      int qEnd = buildQuery(query, host, qtype);
+      int msgLen = qEnd ? upstreamLookup(sock, query, qEnd, msg) : 0;
+      if (msgLen) {
+        bool cloaked;
+        msgLen = checkCloaking(msg, msgLen, qEnd, &cloaked);
+        cacheStore(host, qtype, msg, msgLen, cloaked);
+        Atomic_Increment_u32(&prefetchCnt);
+        LOG_VRB("Prefetched %s type %u", host, qtype);
+      } else {
+        // allow later retry
+        xSemaphoreTake(cacheMutex, portMAX_DELAY);
+        for (int j = 0; j < dnsCacheSize; j++) {
+          CacheEntry* ce = dnsCache + j;
+          if (ce->prefetching && ce->qtype == qtype && strcmp(ce->hostname, host) == 0) {
+            ce->prefetching = false;
+            ce->refreshTime = millis() + STALE_RECHECK;
+          }
+        }
+        xSemaphoreGive(cacheMutex);
+      }
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+static int claimPending(const char* host, dnsSlot_t* slot) {
+  // attach query to an identical outstanding lookup, else register this lookup
+  int freeIdx = PENDING_NONE;
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  for (int i = 0; i < MAX_PENDING; i++) {
+    PendingQuery* pq = pendingQueries + i;
+    if (!pq->active) {
+      if (freeIdx == PENDING_NONE) freeIdx = i;
+    } else if (pq->qtype == slot->qtype && !strcmp(pq->hostname, host)) {
+      if (pq->waitCnt < MAX_WAITERS) {
+        pq->waiters[pq->waitCnt++] = slot;
+        xSemaphoreGive(cacheMutex);
+        Atomic_Increment_u32(&coalescedCnt);
+        LOG_VRB("Coalesced query for %s with outstanding lookup", host);
+        return PENDING_ATTACHED;
+      }
+      freeIdx = PENDING_NONE; // too many waiting, so do separate lookup
+      break;
+    }
+  }
+  if (freeIdx >= 0) {
+    PendingQuery* pq = pendingQueries + freeIdx;
+    strncpy(pq->hostname, host, MAX_HOSTNAME - 1);
+    pq->hostname[MAX_HOSTNAME - 1] = 0;
+    pq->qtype = slot->qtype;
+    pq->waitCnt = 0;
+    pq->active = true;
+  }
+  xSemaphoreGive(cacheMutex);
+  return freeIdx;
+}
+
+static void releasePending(int pendingIdx, uint8_t* msg, int msgLen, bool cloaked) {
+  // lookup complete, answer and log any attached queries and release their slots
+  dnsSlot_t* waiters[MAX_WAITERS];
+  char host[MAX_HOSTNAME];
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  PendingQuery* pq = pendingQueries + pendingIdx;
+  uint8_t waitCnt = pq->waitCnt;
+  memcpy(waiters, pq->waiters, waitCnt * sizeof(dnsSlot_t*));
+  strcpy(host, pq->hostname);
+  pq->active = false;
+  xSemaphoreGive(cacheMutex);
+  for (int i = 0; i < waitCnt; i++) {
+    if (msgLen) sendRelay(waiters[i], msg, msgLen);
+    else sendFailure(waiters[i]);
+    logQuery(waiters[i], host, !msgLen ? VERDICT_ERROR : cloaked ? VERDICT_BLOCKED : VERDICT_ALLOWED,
+      QLOG_COALESCED | (cloaked ? QLOG_CLOAKED : 0));
+    xQueueSend(dnsFreePool, &waiters[i], portMAX_DELAY);
+  }
+}
+
+static bool prepUpstreams() {
+  // convert configured upstream server addresses
+  int validCnt = 0;
+  for (int i = 0; i < NUM_UPSTREAMS; i++) {
+    Upstream* up = upstreams + i;
+    memset(&up->addr, 0, sizeof(up->addr));
+    up->addr.sin_family = AF_INET;
+    up->addr.sin_port = htons(dnsUpstreamPort);
+    up->valid = inet_aton(up->ip, &up->addr.sin_addr);
+    if (up->valid) validCnt++;
+  }
+  if (!validCnt) LOG_WRN("No valid upstream DNS server configured");
+  return validCnt > 0;
+}
+
+static void recordUpstream(int idx, bool success, uint32_t rttMs) {
+  // update upstream health and latency
+  Upstream* up = upstreams + idx;
+  taskENTER_CRITICAL(&upstreamMux);
+  if (success) {
+    up->srtt = up->srtt ? smoothSensor(rttMs, up->srtt, RTT_ALPHA) : rttMs;
+    up->consecFails = 0;
+  } else {
+    up->errors++;
+    if (++up->consecFails >= UPSTREAM_MAX_FAIL) up->retryTime = millis() + UPSTREAM_RETRY;
+  }
+  taskEXIT_CRITICAL(&upstreamMux);
+}
+
+static bool upstreamsDown() {
+  // true if all upstreams have recently failed
+  uint32_t now = millis();
+  bool allDown = true;
+  taskENTER_CRITICAL(&upstreamMux);
+  for (int i = 0; i < NUM_UPSTREAMS; i++) {
+    Upstream* up = upstreams + i;
+    if (up->valid && (up->consecFails < UPSTREAM_MAX_FAIL || (int32_t)(up->retryTime - now) <= 0)) allDown = false;
+  }
+  taskEXIT_CRITICAL(&upstreamMux);
+  return allDown;
+}
+
+static int selectUpstreams(int* order) {
+  // order usable upstreams, healthy ones first by lowest smoothed round trip time
+  uint32_t now = millis();
+  float rank[NUM_UPSTREAMS];
+  int cnt = 0;
+  taskENTER_CRITICAL(&upstreamMux);
+  for (int i = 0; i < NUM_UPSTREAMS; i++) {
+    Upstream* up = upstreams + i;
+    if (!up->valid) continue;
+    bool isDown = up->consecFails >= UPSTREAM_MAX_FAIL && (int32_t)(up->retryTime - now) > 0;
+    // down servers still used as last resort
+    rank[cnt] = isDown ? UPSTREAM_TIMEOUT + up->srtt : up->srtt;
+    order[cnt++] = i;
+  }
+  taskEXIT_CRITICAL(&upstreamMux);
+  if (cnt == 2 && rank[1] < rank[0]) std::swap(order[0], order[1]);
+  return cnt;
+}
+
+static uint32_t upstreamWait(int idx) {
+  // how long to wait for given upstream before also trying next one
+  float srtt = upstreams[idx].srtt;
+  return srtt ? constrain((uint32_t)(srtt * 4), UPSTREAM_MIN_WAIT, UPSTREAM_TIMEOUT / 2) : UPSTREAM_TIMEOUT / 2;
+}
+
+static bool sameQuestion(const uint8_t* msg, const uint8_t* query, int qEnd) {
+  // check response question matches query, ignoring letter case of name
+  for (int i = sizeof(dns_header_t); i < qEnd - 4; i++)
+    if (tolower(msg[i]) != tolower(query[i])) return false;
+  return !memcmp(msg + qEnd - 4, query + qEnd - 4, 4);
+}
+
+static int upstreamLookup(int sock, const uint8_t* query, int qEnd, uint8_t* msg) {
+  // forward query to fastest healthy upstream, or race to both, and return length of response in msg,
+  // which must hold DNS_MSG_LEN bytes
+  // a slow upstream is given upstreamWait() ms before next upstream also tried
+  if (dnsMode != UPSTREAM_UDP) {
+    Atomic_Increment_u32(&upstreamCnt);
+    return tlsLookup(query, qEnd, msg);
+  }
+  int order[NUM_UPSTREAMS];
+  int numUp = selectUpstreams(order);
+  if (sock < 0 || !numUp) return 0;
+  Atomic_Increment_u32(&upstreamCnt);
+
+  // build upstream query from client question with new id, advertising our EDNS payload size
+  uint8_t upQuery[DNS_PKT_LEN];
+  memcpy(upQuery, query, qEnd);
+  dns_header_t* hdr = (dns_header_t*)upQuery;
+  uint16_t upId = (uint16_t)esp_random();
+  hdr->id = upId;
+  hdr->flags = htons(0x0100); // recursion desired
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = 0;
+  hdr->arcount = htons(1);
+  int qLen = writeOPT(upQuery, qEnd, 0);
+
+  uint32_t start = millis();
+  uint32_t sentMs[NUM_UPSTREAMS] = {0};
+  bool waiting[NUM_UPSTREAMS] = {false};
+  int next = 0; // next upstream in order to send to
+  uint32_t nextSendMs = start;
+  while (true) {
+    uint32_t now = millis();
+    bool anyWaiting = false;
+    for (int i = 0; i < numUp; i++) anyWaiting |= waiting[order[i]];
+    // send to next upstream when due, or immediately if nothing outstanding
+    while (next < numUp && (!anyWaiting || (int32_t)(now - nextSendMs) >= 0)) {
+      int u = order[next++];
+      if (sendto(sock, upQuery, qLen, 0, (struct sockaddr*)&upstreams[u].addr, sizeof(upstreams[u].addr)) == qLen) {
+        sentMs[u] = now;
+        waiting[u] = anyWaiting = true;
+        taskENTER_CRITICAL(&upstreamMux);
+        upstreams[u].queries++;
+        taskEXIT_CRITICAL(&upstreamMux);
+      } else recordUpstream(u, false, 0);
+      // when racing, first two sent together
+      nextSendMs = (dnsRace && next < 2) ? now : now + upstreamWait(u);
+    }
+    int32_t remaining = (int32_t)(start + UPSTREAM_TIMEOUT - now);
+    if (!anyWaiting || remaining <= 0) break;
+
+    // wait for response until overall timeout or next upstream due
+    int32_t waitMs = (next < numUp) ? min(remaining, (int32_t)(nextSendMs - now)) : remaining;
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(sock, &readSet);
+    struct timeval tv = {waitMs / 1000, (waitMs % 1000) * 1000};
+    if (select(sock + 1, &readSet, NULL, NULL, &tv) <= 0) continue;
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    int msgLen = recvfrom(sock, msg, DNS_MSG_LEN - OPT_LEN, 0, (struct sockaddr*)&from, &fromLen);
+    if (msgLen < qEnd) continue;
+
+    // identify responding upstream and check response is for this query
+    int u = -1;
+    for (int i = 0; i < numUp; i++) {
+      Upstream* up = upstreams + order[i];
+      if (from.sin_addr.s_addr == up->addr.sin_addr.s_addr && from.sin_port == up->addr.sin_port) u = order[i];
+    }
+    dns_header_t* res = (dns_header_t*)msg;
+    if (u < 0 || !waiting[u] || res->id != upId || !(ntohs(res->flags) & 0x8000)
+      || ntohs(res->qdcount) != 1 || !sameQuestion(msg, upQuery, qEnd)) continue; // stale or spoofed
+    waiting[u] = false;
+    uint8_t rcode = ntohs(res->flags) & 0x000F;
+    if (rcode == RCODE_SERVFAIL || rcode == RCODE_REFUSED) {
+      LOG_VRB("DNS server %s returned rcode %u", upstreams[u].ip, rcode);
+      recordUpstream(u, false, 0);
+      nextSendMs = millis(); // try next upstream now
+      continue;
+    }
+    uint32_t rtt = millis() - sentMs[u];
+    recordUpstream(u, true, rtt);
+    metricsObserve(HIST_UPSTREAM, rtt * 1000);
+    LOG_VRB("Resolved using %s in %lums", upstreams[u].ip, rtt);
+    return stripOPT(msg, msgLen);
+  }
+  // count no response as failure
+  for (int i = 0; i < numUp; i++) {
+    if (waiting[order[i]]) {
+      LOG_VRB("DNS server %s timed out", upstreams[order[i]].ip);
+      recordUpstream(order[i], false, 0);
+    }
+  }
+  return 0;
+}
+
+static bool tcpTransfer(int sock, uint8_t* buf, int len, bool isSend) {
+  // send or receive given number of bytes
+  for (int done = 0; done < len; ) {
+    int n = isSend ? send(sock, buf + done, len - done, 0) : recv(sock, buf + done, len - done, 0);
+    if (n <= 0) return false;
+    done += n;
+  }
+  return true;
+}
+
+static int upstreamTcpLookup(const uint8_t* query, int qEnd, uint8_t* msg, int msgSize) {
+  // repeat query over TCP to fastest upstream, as UDP response was truncated
+  int order[NUM_UPSTREAMS];
+  if (!selectUpstreams(order)) return 0;
+  Upstream* up = upstreams + order[0];
+  int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock < 0) return 0;
+  struct timeval tv = {UPSTREAM_TIMEOUT / 1000, (UPSTREAM_TIMEOUT % 1000) * 1000};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  // length prefixed query with new id
+  uint8_t upQuery[2 + DNS_PKT_LEN];
+  upQuery[0] = qEnd >> 8;
+  upQuery[1] = qEnd;
+  memcpy(upQuery + 2, query, qEnd);
+  dns_header_t* hdr = (dns_header_t*)(upQuery + 2);
+  uint16_t upId = (uint16_t)esp_random();
+  hdr->id = upId;
+  hdr->flags = htons(0x0100); // recursion desired
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = hdr->arcount = 0;
+
+  int msgLen = 0;
+  uint8_t prefix[2];
+  if (connect(sock, (struct sockaddr*)&up->addr, sizeof(up->addr)) == 0
+    && tcpTransfer(sock, upQuery, qEnd + 2, true) && tcpTransfer(sock, prefix, 2, false)) {
+    msgLen = (prefix[0] << 8) | prefix[1];
+    if (msgLen < qEnd || msgLen > msgSize || !tcpTransfer(sock, msg, msgLen, false)) msgLen = 0;
+  }
+  close(sock);
+  dns_header_t* res = (dns_header_t*)msg;
+  if (msgLen && (res->id != upId || !sameQuestion(msg, upQuery + 2, qEnd))) msgLen = 0;
+  if (!msgLen) LOG_VRB("TCP lookup to %s failed", up->ip);
+  return msgLen ? stripOPT(msg, msgLen) : 0;
+}
+
+static void updateUpstreamStats() {
+  // per upstream smoothed latency, queries and errors for web page
+  char statsStr[FILE_NAME_LEN];
+  for (int i = 0; i < NUM_UPSTREAMS; i++) {
+    Upstream* up = upstreams + i;
+    taskENTER_CRITICAL(&upstreamMux);
+    uint32_t srtt = up->srtt;
+    uint32_t queries = up->queries, errors = up->errors;
+    bool isDown = up->consecFails >= UPSTREAM_MAX_FAIL;
+    taskEXIT_CRITICAL(&upstreamMux);
+    snprintf(statsStr, sizeof(statsStr), "%lums %lu/%lu%s", srtt, queries, errors, isDown ? " down" : "");
+    updateConfigVect(i ? "dnsNs2" : "dnsNs1", statsStr);
+  }
+}
+
+static int buildQuery(uint8_t* query, const char* host, uint16_t qtype) {
+  // build DNS query for host, return offset following question
+  memset(query, 0, sizeof(dns_header_t));
+  int offset = writeDNSname(query, sizeof(dns_header_t), host);
+  if (!offset) return 0;
+  query[offset++] = qtype >> 8;
+  query[offset++] = qtype;
+  query[offset++] = 0;
+  query[offset++] = 1; // class IN
+  return offset;
+}
+
+IPAddress resolveDomain(const char* host) {
+  // determine how to resolve received domain name
+  // called outside of DNS workers, eg from web page domain check
+  IPAddress ip(0, 0, 0, 0);
+  if (matchLocalZone(host) >= 0) return ip;
+  uint8_t msg[DNS_MSG_LEN];
+  int msgLen = cacheLookup(host, DNS_TYPE_A, msg);
+  if (!msgLen) {
+    uint8_t query[DNS_PKT_LEN];
+    int qEnd = buildQuery(query, host, DNS_TYPE_A);
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (qEnd && sock >= 0) {
+      msgLen = upstreamLookup(sock, query, qEnd, msg);
+      if (msgLen) {
+        bool cloaked;
+        msgLen = checkCloaking(msg, msgLen, qEnd, &cloaked);
+        cacheStore(host, DNS_TYPE_A, msg, msgLen, cloaked);
+      }
+      else msgLen = cacheLookup(host, DNS_TYPE_A, msg, true);
+    }
+    if (sock >= 0) close(sock);
+  }
+  if (msgLen) ip = firstAddress(msg, msgLen);
+  return ip;
+}
+
+/************************ Local Zones ****************************/
+
+// names under local zones are not sent upstream or checked against blocklist,
+// but forwarded to router, answered NXDOMAIN, or answered with a static address
+
+#define MAX_ZONES 16
+#define MAX_ZONE_LEN 48
+
+enum zoneAction {ZONE_FORWARD, ZONE_NXDOMAIN, ZONE_STATIC};
+
+struct LocalZone {
+  char name[MAX_ZONE_LEN]; // lower case, without leading dot or trailing *
+  uint8_t len;
+  bool isPrefix; // matches start of name, eg wpad*, rather than whole trailing labels
+  uint8_t action;
+  uint32_t hash; // of name read backwards, to match suffixes while scanning host from end
+  uint32_t addr; // for ZONE_STATIC
+};
+static LocalZone localZones[MAX_ZONES];
+static int zoneCnt = 0;
+static struct sockaddr_in routerAddr;
+
+static uint32_t zoneHash(const char* name, int len) {
+  uint32_t hash = FNV_BASIS;
+  for (int i = len - 1; i >= 0; i--) hash = (hash ^ tolower(name[i])) * FNV_PRIME;
+  return hash;
+}
+
+static void prepZones() {
+  // compile local zone table from dnsZones, comma separated zone=action entries,
+  // where action is fwd, nx or an IPv4 address, eg "home=fwd,local=nx,wpad*=nx,nas.lan=192.168.1.20"
+  char zoneCfg[IN_FILE_NAME_LEN];
+  strncpy(zoneCfg, dnsZones, sizeof(zoneCfg) - 1);
+  zoneCfg[sizeof(zoneCfg) - 1] = '\0';
+  char* savePtr;
+  zoneCnt = 0;
+  for (char* entry = strtok_r(zoneCfg, ", ", &savePtr); entry != NULL && zoneCnt < MAX_ZONES;
+    entry = strtok_r(NULL, ", ", &savePtr)) {
+    char* actionStr = strchr(entry, '=');
+    if (actionStr == NULL) {
+      LOG_WRN("Ignored local zone without action: %s", entry);
+      continue;
+    }
+    *actionStr++ = '\0';
+    LocalZone* zone = localZones + zoneCnt;
+    if (*entry == '.') entry++;
+    size_t len = strlen(entry);
+    zone->isPrefix = len && entry[len - 1] == '*';
+    if (zone->isPrefix) len--;
+    IPAddress staticIP;
+    if (!strcmp(actionStr, "fwd")) zone->action = ZONE_FORWARD;
+    else if (!strcmp(actionStr, "nx")) zone->action = ZONE_NXDOMAIN;
+    else if (staticIP.fromString(actionStr)) {
+      zone->action = ZONE_STATIC;
+      zone->addr = (uint32_t)staticIP;
+    } else len = 0;
+    if (!len || len >= MAX_ZONE_LEN) {
+      LOG_WRN("Ignored invalid local zone: %s=%s", entry, actionStr);
+      continue;
+    }
+    for (size_t i = 0; i < len; i++) zone->name[i] = tolower(entry[i]);
+    zone->name[len] = '\0';
+    zone->len = len;
+    zone->hash = zoneHash(zone->name, len);
+    zoneCnt++;
+  }
+
+  // router used for forwarded zones, as it knows LAN host names
+  IPAddress routerIP;
+  if (!routerIP.fromString(ST_gw)) routerIP = netGatewayIP();
+  memset(&routerAddr, 0, sizeof(routerAddr));
+  routerAddr.sin_family = AF_INET;
+  routerAddr.sin_port = htons(dnsUpstreamPort);
+  routerAddr.sin_addr.s_addr = (uint32_t)routerIP;
+  LOG_INF("Loaded %d local zones, forwarding to %s", zoneCnt, routerIP.toString().c_str());
+}
+
+static int matchLocalZone(const char* host) {
+  // return index of local zone containing host, or -1 if none
+  // longest matching suffix is used, prefix zones taking precedence
+  if (!zoneCnt) return -1;
+  for (int i = 0; i < zoneCnt; i++)
+    if (localZones[i].isPrefix && !strncasecmp(host, localZones[i].name, localZones[i].len)) return i;
+
+  // hash host backwards, checking table at each label boundary
+  int hostLen = strlen(host);
+  uint32_t hash = FNV_BASIS;
+  int zoneIdx = -1;
+  for (int pos = hostLen - 1; pos >= 0; pos--) {
+    hash = (hash ^ tolower(host[pos])) * FNV_PRIME;
+    if (pos && host[pos - 1] != '.') continue;
+    for (int i = 0; i < zoneCnt; i++) {
+      LocalZone* zone = localZones + i;
+      if (zone->hash == hash && zone->len == hostLen - pos && !zone->isPrefix
+        && !strncasecmp(host + pos, zone->name, zone->len)) zoneIdx = i;
+    }
+  }
+  return zoneIdx;
+}
+
+static int routerLookup(int sock, const uint8_t* query, int qEnd, uint8_t* msg) {
+  // forward query to router and return length of response in msg, which must hold DNS_MSG_LEN bytes
+  if (sock < 0 || !routerAddr.sin_addr.s_addr) return 0;
+  uint8_t upQuery[DNS_PKT_LEN];
+  memcpy(upQuery, query, qEnd);
+  dns_header_t* hdr = (dns_header_t*)upQuery;
+  uint16_t upId = (uint16_t)esp_random();
+  hdr->id = upId;
+  hdr->flags = htons(0x0100); // recursion desired
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = hdr->arcount = 0;
+  if (sendto(sock, upQuery, qEnd, 0, (struct sockaddr*)&routerAddr, sizeof(routerAddr)) != qEnd) return 0;
+
+  uint32_t start = millis();
+  int32_t remaining;
+  while ((remaining = (int32_t)(start + UPSTREAM_TIMEOUT - millis())) > 0) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(sock, &readSet);
+    struct timeval tv = {remaining / 1000, (remaining % 1000) * 1000};
+    if (select(sock + 1, &readSet, NULL, NULL, &tv) <= 0) continue;
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    int msgLen = recvfrom(sock, msg, DNS_MSG_LEN - OPT_LEN, 0, (struct sockaddr*)&from, &fromLen);
+    dns_header_t* res = (dns_header_t*)msg;
+    if (msgLen < qEnd || from.sin_addr.s_addr != routerAddr.sin_addr.s_addr || res->id != upId
+      || !(ntohs(res->flags) & 0x8000) || !sameQuestion(msg, upQuery, qEnd)) continue; // stale or spoofed
+    return stripOPT(msg, msgLen);
+  }
+  LOG_VRB("No response from router for local name");
+  return 0;
+}
+
+static void answerLocalZone(dnsSlot_t* slot, int zoneIdx, int upSock) {
+  // respond to query for name in local zone
+  LocalZone* zone = localZones + zoneIdx;
+  uint8_t msg[DNS_MSG_LEN];
+  int msgLen;
+  Atomic_Increment_u32(&localCnt);
+  if (zone->action == ZONE_FORWARD) {
+    msgLen = routerLookup(upSock, slot->data, slot->qEnd, msg);
+    if (msgLen) sendRelay(slot, msg, msgLen);
+    else sendFailure(slot);
+    return;
+  }
+  if (zone->action == ZONE_STATIC) {
+    // static address for type A, other types have no data
+    memcpy(msg, slot->data, slot->qEnd);
+    if (slot->qtype == DNS_TYPE_A) msgLen = buildAnswer(msg, slot->qEnd, IPAddress(zone->addr));
+    else msgLen = buildErrorResponse(msg, slot->data, slot->qEnd, 0);
+  } else msgLen = buildErrorResponse(msg, slot->data, slot->qEnd, RCODE_NXDOMAIN);
+  dns_header_t* res = (dns_header_t*)msg;
+  res->flags |= htons(DNS_FLAG_AA);
+  sendResponse(slot, msg, msgLen);
+}
+
+/************************* Hosts File ****************************/
+
+// static A, AAAA and PTR records for LAN devices, answered authoritatively,
+// loaded from hosts file on storage in /etc/hosts format, eg "192.168.1.20 nas nas.home"
+// records are indexed by name and by address in hash tables, rebuilt on reload
+
+#define MAX_HOSTS 1024 // records, as indexed by uint16_t
+#define HOSTS_NONE 0xFFFF // end of hash chain
+#define HOSTS_LINE_LEN 256
+#define HOSTS_TTL 60 // secs
+
+struct HostRecord {
+  uint32_t nameHash;
+  uint16_t nameOff; // offset of lower case name in names
+  uint16_t nextName; // next record in same name bucket
+  uint16_t nextAddr; // next record in same address bucket
+  uint8_t addrLen; // 4 or 16
+  uint8_t addr[16];
+};
+
+struct HostsTable {
+  uint16_t recCnt;
+  uint16_t bucketMask;
+  uint32_t namesLen;
+  uint16_t* nameBuckets;
+  uint16_t* addrBuckets;
+  HostRecord* recs;
+  char* names;
+};
+
+static HostsTable* hostsTable = NULL;
+
+static uint32_t hostsHash(const uint8_t* data, int len, bool isName) {
+  uint32_t hash = FNV_BASIS;
+  for (int i = 0; i < len; i++) hash = (hash ^ (isName ? tolower(data[i]) : data[i])) * FNV_PRIME;
+  return hash;
+}
+
+static int readHosts(File& file, HostsTable* table, uint32_t* namesLen) {
+  // parse hosts file into table, return number of records
+  // if table is NULL, only count records and space needed for names
+  int recCnt = 0;
+  char line[HOSTS_LINE_LEN];
+  *namesLen = 0;
+  while (file.available()) {
+    size_t lineLen = file.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[lineLen] = '\0';
+    char* comment = strchr(line, '#');
+    if (comment != NULL) *comment = '\0';
+    char* savePtr;
+    char* ipStr = strtok_r(line, " \t\r", &savePtr);
+    if (ipStr == NULL) continue;
+    uint8_t addr[16];
+    int addrLen = 16;
+    if (inet_pton(AF_INET, ipStr, addr) == 1) addrLen = 4;
+    else if (inet_pton(AF_INET6, ipStr, addr) != 1) {
+      if (table == NULL) LOG_WRN("Invalid address in hosts file: %s", ipStr);
+      continue;
+    }
+    bool firstName = true;
+    for (char* name = strtok_r(NULL, " \t\r", &savePtr); name != NULL; name = strtok_r(NULL, " \t\r", &savePtr)) {
+      int nameLen = strlen(name) + 1;
+      if (recCnt >= MAX_HOSTS || *namesLen + nameLen > HOSTS_NONE || nameLen > MAX_HOSTNAME) break;
+      if (table != NULL) {
+        HostRecord* rec = table->recs + recCnt;
+        char* recName = table->names + *namesLen;
+        for (int i = 0; i < nameLen; i++) recName[i] = tolower(name[i]);
+        rec->nameOff = *namesLen;
+        rec->nameHash = hostsHash((uint8_t*)recName, nameLen - 1, true);
+        rec->addrLen = addrLen;
+        memcpy(rec->addr, addr, addrLen);
+        uint16_t* bucket = table->nameBuckets + (rec->nameHash & table->bucketMask);
+        rec->nextName = *bucket;
+        *bucket = recCnt;
+        // only first name for address used for reverse lookup
+        rec->nextAddr = HOSTS_NONE;
+        if (firstName) {
+          bucket = table->addrBuckets + (hostsHash(addr, addrLen, false) & table->bucketMask);
+          rec->nextAddr = *bucket;
+          *bucket = recCnt;
+        }
+      }
+      firstName = false;
+      *namesLen += nameLen;
+      recCnt++;
+    }
+  }
+  return recCnt;
+}
+
+void loadHosts() {
+  // load or reload hosts file, replacing table in use by DNS workers
+  if (hostsMutex == NULL) return;
+  HostsTable* newTable = NULL;
+  File file = STORAGE.open(HOSTS_FILE_PATH, FILE_READ);
+  if (file) {
+    uint32_t namesLen;
+    int recCnt = readHosts(file, NULL, &namesLen);
+    if (recCnt) {
+      // at least twice as many buckets as records to keep chains short
+      uint16_t bucketCnt = 16;
+      while (bucketCnt < recCnt * 2) bucketCnt <<= 1;
+      size_t tableSize = sizeof(HostsTable) + 2 * bucketCnt * sizeof(uint16_t)
+        + recCnt * sizeof(HostRecord) + namesLen;
+      newTable = (HostsTable*)malloc(tableSize);
+      if (newTable != NULL) {
+        newTable->bucketMask = bucketCnt - 1;
+        newTable->nameBuckets = (uint16_t*)(newTable + 1);
+        newTable->addrBuckets = newTable->nameBuckets + bucketCnt;
+        newTable->recs = (HostRecord*)(newTable->addrBuckets + bucketCnt);
+        newTable->names = (char*)(newTable->recs + recCnt);
+        memset(newTable->nameBuckets, 0xFF, 2 * bucketCnt * sizeof(uint16_t));
+        file.seek(0);
+        newTable->recCnt = readHosts(file, newTable, &newTable->namesLen);
+      } else LOG_ERR("Insufficient memory for %d hosts file records", recCnt);
+    }
+    file.close();
+  }
+  xSemaphoreTake(hostsMutex, portMAX_DELAY);
+  HostsTable* oldTable = hostsTable;
+  hostsTable = newTable;
+  xSemaphoreGive(hostsMutex);
+  free(oldTable);
+  LOG_INF("Loaded %u records from %s", newTable ? newTable->recCnt : 0, HOSTS_FILE_PATH);
+}
+
+static int reverseAddr(const char* host, uint8_t* addr) {
+  // convert reverse lookup name to address, return address length, or 0 if not valid
+  int hostLen = strlen(host);
+  if (hostLen > 13 && !strcasecmp(host + hostLen - 13, ".in-addr.arpa")) {
+    // eg 20.1.168.192.in-addr.arpa
+    unsigned int octet[4];
+    int parsed = 0;
+    if (sscanf(host, "%u.%u.%u.%u.%n", octet + 3, octet + 2, octet + 1, octet, &parsed) != 4
+      || parsed != hostLen - 12) return 0;
+    for (int i = 0; i < 4; i++) {
+      if (octet[i] > 255) return 0;
+      addr[i] = octet[i];
+    }
+    return 4;
+  }
+  if (hostLen == 72 && !strcasecmp(host + 63, ".ip6.arpa")) {
+    // 32 nibbles, least significant first
+    memset(addr, 0, 16);
+    for (int i = 0; i < 32; i++) {
+      char c = tolower(host[i * 2]);
+      if (!isxdigit(c) || (i < 31 && host[i * 2 + 1] != '.')) return 0;
+      uint8_t nibble = isdigit(c) ? c - '0' : c - 'a' + 10;
+      addr[15 - i / 2] |= (i % 2) ? nibble << 4 : nibble;
+    }
+    return 16;
+  }
+  return 0;
+}
+
+static int writeRRheader(uint8_t* msg, int offset, uint16_t type, uint16_t rdLen) {
+  // answer record for name in question, return offset of rdata
+  msg[offset++] = 0xC0;
+  msg[offset++] = 0x0C;
+  msg[offset++] = type >> 8;
+  msg[offset++] = type;
+  msg[offset++] = 0x00;
+  msg[offset++] = 0x01; // class IN
+  msg[offset++] = 0;
+  msg[offset++] = 0;
+  msg[offset++] = HOSTS_TTL >> 8;
+  msg[offset++] = HOSTS_TTL & 0xFF;
+  msg[offset++] = rdLen >> 8;
+  msg[offset++] = rdLen;
+  return offset;
+}
+
+static bool answerHosts(dnsSlot_t* slot, const char* domain) {
+  // answer query from hosts file if name, or address for PTR query, is present
+  if (hostsTable == NULL) return false;
+  uint8_t tx[DNS_MSG_LEN];
+  uint8_t addr[16];
+  int offset = slot->qEnd;
+  int addrLen = (slot->qtype == DNS_TYPE_PTR) ? reverseAddr(domain, addr) : 0;
+  uint16_t ancount = 0;
+  bool found = false;
+  memcpy(tx, slot->data, offset);
+
+  xSemaphoreTake(hostsMutex, portMAX_DELAY);
+  HostsTable* table = hostsTable;
+  if (table != NULL && addrLen) {
+    uint16_t i = table->addrBuckets[hostsHash(addr, addrLen, false) & table->bucketMask];
+    for (; i != HOSTS_NONE && !found; i = table->recs[i].nextAddr) {
+      HostRecord* rec = table->recs + i;
+      if (rec->addrLen != addrLen || memcmp(rec->addr, addr, addrLen)) continue;
+      int rdOffset = writeRRheader(tx, offset, DNS_TYPE_PTR, 0);
+      int rdEnd = writeDNSname(tx, rdOffset, table->names + rec->nameOff);
+      if (rdEnd) {
+        tx[rdOffset - 2] = (rdEnd - rdOffset) >> 8;
+        tx[rdOffset - 1] = rdEnd - rdOffset;
+        offset = rdEnd;
+        ancount = 1;
+        found = true;
+      }
+    }
+  } else if (table != NULL) {
+    uint32_t hash = hostsHash((const uint8_t*)domain, strlen(domain), true);
+    for (uint16_t i = table->nameBuckets[hash & table->bucketMask]; i != HOSTS_NONE; i = table->recs[i].nextName) {
+      HostRecord* rec = table->recs + i;
+      if (rec->nameHash != hash || strcasecmp(table->names + rec->nameOff, domain)) continue;
+      // name known, so answer authoritatively even if no address of requested type
+      found = true;
+      uint16_t rrType = (rec->addrLen == 4) ? DNS_TYPE_A : DNS_TYPE_AAAA;
+      if (rrType != slot->qtype || offset + 12 + rec->addrLen > DNS_PKT_LEN - OPT_LEN) continue;
+      offset = writeRRheader(tx, offset, rrType, rec->addrLen);
+      memcpy(tx + offset, rec->addr, rec->addrLen);
+      offset += rec->addrLen;
+      ancount++;
+    }
+  }
+  xSemaphoreGive(hostsMutex);
+  if (!found) return false;
+
+  dns_header_t* res = (dns_header_t*)tx;
+  res->flags = htons(0x8080 | DNS_FLAG_AA | (ntohs(res->flags) & 0x0100)); // response, AA, copy RD, set RA
+  res->ancount = htons(ancount);
+  res->nscount = res->arcount = 0;
+  sendResponse(slot, tx, offset);
+  Atomic_Increment_u32(&hostsCnt);
+  return true;
+}
+
+/******************** DNS over TLS / HTTPS ***********************/
+
+#define DOT_PORT 853
+#define MAX_TLS_CONNS 2
+#define TLS_MAX_INFLIGHT 8 // pipelined queries per connection
+#define TLS_CONNECT_TIMEOUT 1500 // ms for connection and handshake, within worker wait
+#define TLS_CONNECT_FAILS 3 // consecutive failures before waiting UPSTREAM_RETRY to reconnect
+
+// lookup passed from worker to TLS connection task, which notifies worker on completion.
+// Allocated by worker and freed by whichever of worker and task finishes with it last,
+// as worker stops waiting after UPSTREAM_TIMEOUT, eg while connection being made
+struct TlsRequest {
+  uint8_t query[DNS_PKT_LEN];
+  int qEnd;
+  uint8_t msg[DNS_MSG_LEN];
+  int msgLen; // 0 if failed
+  uint16_t id; // id used on connection
+  uint32_t sentMs;
+  TaskHandle_t waiter; // NULL once worker has stopped waiting
+  bool done;
+};
+static QueueHandle_t tlsQueue = NULL;
+
+// stats
+static portMUX_TYPE tlsMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t tlsHandshakes = 0, tlsQueries = 0, tlsReused = 0, tlsFailed = 0;
+static float tlsLatency = 0; // smoothed ms
+
+static int tlsLookup(const uint8_t* query, int qEnd, uint8_t* msg) {
+  // pass query to a TLS or HTTPS connection task and wait for response, for at most
+  // UPSTREAM_TIMEOUT so that stale answer or SERVFAIL is given if upstream unavailable
+  TlsRequest* req = (TlsRequest*)ps_malloc(sizeof(TlsRequest));
+  if (req == NULL) return 0;
+  memcpy(req->query, query, qEnd);
+  req->qEnd = qEnd;
+  req->msgLen = 0;
+  req->waiter = xTaskGetCurrentTaskHandle();
+  req->done = false;
+  if (xQueueSend(tlsQueue, &req, 0) != pdTRUE) {
+    free(req);
+    return 0;
+  }
+  bool notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPSTREAM_TIMEOUT));
+  taskENTER_CRITICAL(&tlsMux);
+  bool done = req->done;
+  if (!done) req->waiter = NULL; // task to free request
+  taskEXIT_CRITICAL(&tlsMux);
+  if (!done) return 0;
+  // completed as wait timed out, so take notification now due, to not end a later wait early
+  if (!notified) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  int msgLen = req->msgLen;
+  if (msgLen) memcpy(msg, req->msg, msgLen);
+  free(req);
+  return msgLen ? stripOPT(msg, msgLen) : 0;
+}
+
+static void tlsComplete(TlsRequest* req, int msgLen) {
+  taskENTER_CRITICAL(&tlsMux);
+  req->msgLen = msgLen;
+  req->done = true;
+  TaskHandle_t waiter = req->waiter;
+  if (!msgLen) tlsFailed++;
+  taskEXIT_CRITICAL(&tlsMux);
+  if (waiter != NULL) xTaskNotifyGive(waiter);
+  else free(req); // worker no longer waiting
+}
+
+static void tlsFailAll(NetworkClientSecure& client, TlsRequest** inflight, int& inflightCnt) {
+  // connection lost or stalled, so fail outstanding queries
+  client.stop();
+  for (int i = 0; i < TLS_MAX_INFLIGHT; i++) {
+    if (inflight[i] != NULL) tlsComplete(inflight[i], 0);
+    inflight[i] = NULL;
+  }
+  inflightCnt = 0;
+}
+
+static bool tlsConnect(NetworkClientSecure& client, uint8_t& fails, uint32_t& failMs) {
+  // (re)establish TLS session with upstream in a single bounded attempt, as workers waiting,
+  // with fail count and time of last failure held by each connection task
+  if (fails >= TLS_CONNECT_FAILS && millis() - failMs < UPSTREAM_RETRY) return false; // upstream down
+  if (ESP.getFreeHeap() > TLS_HEAP) {
+    if (useSecure && strlen(dns_rootCACertificate)) client.setCACert(dns_rootCACertificate);
+    else client.setInsecure();
+    client.setHandshakeTimeout((TLS_CONNECT_TIMEOUT + 999) / 1000);
+    if (client.connect(dnsTlsHost, DOT_PORT, TLS_CONNECT_TIMEOUT)) {
+      fails = 0;
+      taskENTER_CRITICAL(&tlsMux);
+      tlsHandshakes++;
+      taskEXIT_CRITICAL(&tlsMux);
+      LOG_VRB("DNS over TLS connected to %s", dnsTlsHost);
+      return true;
+    }
+    char buf[100];
+    int err = client.lastError(buf, sizeof(buf));
+    LOG_WRN("DNS over TLS failed to connect to %s, err %d: %s", dnsTlsHost, err, buf);
+  } else LOG_WRN("Insufficient heap %s for DNS over TLS session", fmtSize(ESP.getFreeHeap()));
+  if (fails < TLS_CONNECT_FAILS) fails++;
+  failMs = millis();
+  return false;
+}
+
+static bool tlsSendQuery(NetworkClientSecure& client, TlsRequest* req) {
+  // send length prefixed query with id unique on this connection
+  static uint16_t nextId = (uint16_t)esp_random();
+  uint8_t frame[2 + DNS_PKT_LEN];
+  frame[0] = req->qEnd >> 8;
+  frame[1] = req->qEnd;
+  memcpy(frame + 2, req->query, req->qEnd);
+  dns_header_t* hdr = (dns_header_t*)(frame + 2);
+  taskENTER_CRITICAL(&tlsMux);
+  req->id = nextId++;
+  taskEXIT_CRITICAL(&tlsMux);
+  hdr->id = req->id;
+  hdr->flags = htons(0x0100); // recursion desired
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = hdr->arcount = 0;
+  req->sentMs = millis();
+  return client.write(frame, req->qEnd + 2) == (size_t)(req->qEnd + 2);
+}
+
+static void tlsResponse(uint8_t* rsp, int rspLen, TlsRequest** inflight, int& inflightCnt) {
+  // match response to outstanding query by id
+  dns_header_t* hdr = (dns_header_t*)rsp;
+  for (int i = 0; i < TLS_MAX_INFLIGHT; i++) {
+    TlsRequest* req = inflight[i];
+    if (req == NULL || req->id != hdr->id) continue;
+    inflight[i] = NULL;
+    inflightCnt--;
+    if (rspLen < req->qEnd || rspLen > DNS_MSG_LEN - OPT_LEN || !sameQuestion(rsp, req->query, req->qEnd)) tlsComplete(req, 0);
+    else {
+      uint32_t latency = millis() - req->sentMs;
+      taskENTER_CRITICAL(&tlsMux);
+      tlsLatency = tlsLatency ? smoothSensor(latency, tlsLatency, RTT_ALPHA) : latency;
+      taskEXIT_CRITICAL(&tlsMux);
+      metricsObserve(HIST_UPSTREAM, latency * 1000);
+      memcpy(req->msg, rsp, rspLen);
+      tlsComplete(req, rspLen);
+      LOG_VRB("Resolved using %s in %lums", dnsTlsHost, latency);
+    }
+    return;
+  }
+}
+
+static void dnsTlsTask(void* arg) {
+  // own a persistent TLS connection to upstream, pipelining queries from the workers
+  NetworkClientSecure client;
+  TlsRequest* inflight[TLS_MAX_INFLIGHT] = {NULL};
+  int inflightCnt = 0;
+  uint8_t rxBuf[2 + DNS_MSG_LEN]; // partially received response
+  int rxLen = 0;
+  uint8_t connectFails = 0;
+  uint32_t connectFailMs = 0;
+  while (true) {
+    // send new queries without waiting for earlier responses, only block if none outstanding
+    TlsRequest* req;
+    while (inflightCnt < TLS_MAX_INFLIGHT
+      && xQueueReceive(tlsQueue, &req, inflightCnt ? 0 : pdMS_TO_TICKS(1000)) == pdTRUE) {
+      bool reused = client.connected();
+      if (!reused) {
+        rxLen = 0;
+        if (!tlsConnect(client, connectFails, connectFailMs)) {
+          // also fail queued queries rather than each wait for a connection attempt
+          do tlsComplete(req, 0);
+          while (xQueueReceive(tlsQueue, &req, 0) == pdTRUE);
+          continue;
+        }
+      }
+      if (!tlsSendQuery(client, req)) {
+        tlsComplete(req, 0);
+        tlsFailAll(client, inflight, inflightCnt);
+        continue;
+      }
+      taskENTER_CRITICAL(&tlsMux);
+      tlsQueries++;
+      if (reused) tlsReused++;
+      taskEXIT_CRITICAL(&tlsMux);
+      for (int i = 0; i < TLS_MAX_INFLIGHT; i++) {
+        if (inflight[i] == NULL) {
+          inflight[i] = req;
+          break;
+        }
+      }
+      inflightCnt++;
+    }
+    if (!inflightCnt) continue;
+
+    // read responses as available, in any order
+    bool gotData = false;
+    while (client.available()) {
+      int want = (rxLen < 2) ? 2 - rxLen : ((rxBuf[0] << 8) | rxBuf[1]) + 2 - rxLen;
+      int got = client.read(rxBuf + rxLen, want);
+      if (got <= 0) break;
+      gotData = true;
+      rxLen += got;
+      if (rxLen == 2 && ((rxBuf[0] << 8) | rxBuf[1]) > DNS_MSG_LEN) {
+        LOG_WRN("Invalid DNS over TLS response length");
+        tlsFailAll(client, inflight, inflightCnt);
+        break;
+      }
+      if (rxLen > 2 && rxLen == ((rxBuf[0] << 8) | rxBuf[1]) + 2) {
+        tlsResponse(rxBuf + 2, rxLen - 2, inflight, inflightCnt);
+        rxLen = 0;
+      }
+    }
+    // fail queries on lost or stalled connection
+    uint32_t now = millis();
+    bool timedOut = false;
+    for (int i = 0; i < TLS_MAX_INFLIGHT; i++)
+      if (inflight[i] != NULL && now - inflight[i]->sentMs > UPSTREAM_TIMEOUT) timedOut = true;
+    if (timedOut || !client.connected()) {
+      if (timedOut) LOG_VRB("DNS over TLS query timed out");
+      tlsFailAll(client, inflight, inflightCnt);
+    } else if (!gotData) delay(1);
+  }
+}
+
+static int dohPost(HTTPClient& http, NetworkClient& client, TlsRequest* req) {
+  // send query as RFC 8484 POST, return response length in req->msg, or 0 if failed
+  uint8_t query[DNS_PKT_LEN];
+  memcpy(query, req->query, req->qEnd);
+  dns_header_t* hdr = (dns_header_t*)query;
+  hdr->id = 0; // recommended for HTTP caching
+  hdr->flags = htons(0x0100); // recursion desired
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = hdr->arcount = 0;
+  int msgLen = 0;
+  if (!http.begin(client, dnsDohUrl)) return 0;
+  http.addHeader("Content-Type", "application/dns-message");
+  http.addHeader("Accept", "application/dns-message");
+  req->sentMs = millis();
+  int httpCode = http.POST(query, req->qEnd);
+  if (httpCode == HTTP_CODE_OK) {
+    msgLen = http.getSize();
+    if (msgLen < 0) {
+      // no content length as chunked or ended by close, so read body to its end
+      String body = http.getString();
+      msgLen = body.length();
+      if (msgLen <= DNS_MSG_LEN - OPT_LEN) memcpy(req->msg, body.c_str(), msgLen);
+    } else if (msgLen <= DNS_MSG_LEN - OPT_LEN
+      && http.getStreamPtr()->readBytes(req->msg, msgLen) != (size_t)msgLen) msgLen = 0;
+    if (msgLen < req->qEnd || msgLen > DNS_MSG_LEN - OPT_LEN
+      || !sameQuestion(req->msg, query, req->qEnd)) msgLen = 0;
+  } else LOG_VRB("DNS over HTTPS failed, error: %s", http.errorToString(httpCode).c_str());
+  http.end(); // connection kept open unless server closes it
+  return msgLen;
+}
+
+static void dnsDohTask(void* arg) {
+  // own a keep-alive connection to DNS over HTTPS server, sending queued queries back to back
+  NetworkClientSecure sclient;
+  NetworkClient pclient; // for plain http, eg local test server
+  bool isSecure = strncmp(dnsDohUrl, "http:", 5) != 0;
+  if (useSecure && strlen(dns_rootCACertificate)) sclient.setCACert(dns_rootCACertificate);
+  else sclient.setInsecure();
+  NetworkClient& client = isSecure ? static_cast<NetworkClient&>(sclient) : pclient;
+  HTTPClient http;
+  http.setReuse(true);
+  http.setTimeout(UPSTREAM_TIMEOUT);
+  http.setConnectTimeout(TLS_CONNECT_TIMEOUT);
+  TlsRequest* req;
+  while (true) {
+    if (xQueueReceive(tlsQueue, &req, portMAX_DELAY) != pdTRUE) continue;
+    bool reused = client.connected();
+    if (!reused && isSecure && ESP.getFreeHeap() <= TLS_HEAP) {
+      LOG_WRN("Insufficient heap %s for DNS over HTTPS session", fmtSize(ESP.getFreeHeap()));
+      tlsComplete(req, 0);
+      continue;
+    }
+    int msgLen = dohPost(http, client, req);
+    taskENTER_CRITICAL(&tlsMux);
+    tlsQueries++;
+    if (reused) tlsReused++;
+    else if (client.connected() || msgLen) tlsHandshakes++;
+    taskEXIT_CRITICAL(&tlsMux);
+    if (msgLen) {
+      uint32_t latency = millis() - req->sentMs;
+      taskENTER_CRITICAL(&tlsMux);
+      tlsLatency = tlsLatency ? smoothSensor(latency, tlsLatency, RTT_ALPHA) : latency;
+      taskEXIT_CRITICAL(&tlsMux);
+      metricsObserve(HIST_UPSTREAM, latency * 1000);
+      LOG_VRB("Resolved using %s in %lums", dnsDohUrl, latency);
+    }
+    tlsComplete(req, msgLen);
+  }
+}
+
+static bool startDNStls() {
+  // start tasks each owning a TLS or HTTPS connection to upstream
+  tlsQueue = xQueueCreate(MAX_DNS_QUEUE, sizeof(TlsRequest*));
+  if (tlsQueue == NULL) return false;
+  if (dnsMode == UPSTREAM_HTTPS) {
+    xTaskCreateWithCaps(dnsDohTask, "dnsDoh", DNS_TLS_STACK_SIZE, NULL, DNS_PRI, NULL, STACK_MEM);
+    LOG_INF("Using DNS over HTTPS to %s", dnsDohUrl);
+    return true;
+  }
+  dnsTlsConns = constrain(dnsTlsConns, 1, MAX_TLS_CONNS);
+  for (int i = 0; i < dnsTlsConns; i++) {
+    char taskName[16];
+    snprintf(taskName, sizeof(taskName), "dnsTls%d", i);
+    xTaskCreateWithCaps(dnsTlsTask, taskName, DNS_TLS_STACK_SIZE, NULL, DNS_PRI, NULL, STACK_MEM);
+  }
+  LOG_INF("Using DNS over TLS to %s with %u connections", dnsTlsHost, dnsTlsConns);
+  return true;
+}
+
+static void updateTlsStats() {
+  // TLS connection reuse and query latency
+  if (dnsMode == UPSTREAM_UDP) return;
+  char statsStr[FILE_NAME_LEN];
+  taskENTER_CRITICAL(&tlsMux);
+  uint32_t handshakes = tlsHandshakes, queries = tlsQueries, reused = tlsReused, failed = tlsFailed;
+  uint32_t latency = tlsLatency;
+  taskEXIT_CRITICAL(&tlsMux);
+  snprintf(statsStr, sizeof(statsStr), "%lu %lu/%lu %lu%% %lums", handshakes, queries, failed,
+    queries ? reused * 100 / queries : 0, latency);
+  updateConfigVect("dnsTls", statsStr);
+}
+
+/************************* Query Capture *************************/
+
+// each received query recorded in ring buffer in psram, oldest overwritten when full,
+// downloaded as binary file for replay by extras/hostBuild/dnsReplay
+// file is CaptureHeader then records, each CaptureRecord followed by query name in wire format
+
+#define CAPTURE_MAGIC 0x43514441 // "ADQC"
+#define CAPTURE_VERSION 1
+#define CAPTURE_TCP 0x01 // record flag
+
+struct CaptureHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordLen; // size of CaptureRecord
+  uint32_t records;
+  uint32_t bytes; // of records following header
+} __attribute__((packed));
+
+struct CaptureRecord {
+  uint32_t ms; // time received
+  uint32_t clientIP; // network byte order
+  uint16_t qtype;
+  uint8_t flags;
+  uint8_t nameLen; // including terminating root label
+} __attribute__((packed));
+
+uint16_t dnsCapture = 0; // KB of psram for query capture, 0 to disable, applied on restart
+static uint8_t* captureBuf = NULL;
+static size_t captureSize = 0;
+static size_t captureHead = 0; // next write offset
+static size_t captureTail = 0; // offset of oldest record
+static size_t captureUsed = 0;
+static uint32_t captureCnt = 0; // records in buffer
+static uint32_t captureTotal = 0; // records since started
+static bool capturePaused = false; // while being downloaded
+static portMUX_TYPE captureMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void prepCapture() {
+  if (!dnsCapture) return;
+  captureSize = dnsCapture * 1024;
+  captureBuf = (uint8_t*)ps_malloc(captureSize);
+  if (captureBuf == NULL) LOG_WRN("Insufficient memory for %uKB query capture", dnsCapture);
+  else LOG_INF("Query capture using %uKB", dnsCapture);
+}
+
+static void ringWrite(const uint8_t* data, size_t len) {
+  // copy into capture ring at head, wrapping at end
+  size_t first = min(len, captureSize - captureHead);
+  memcpy(captureBuf + captureHead, data, first);
+  memcpy(captureBuf, data + first, len - first);
+  captureHead = (captureHead + len) % captureSize;
+}
+
+static void captureQuery(const uint8_t* query, int len, uint32_t clientIP, bool isTcp) {
+  // record query name and type, without decompression as a question name is never compressed
+  if (captureBuf == NULL || capturePaused) return;
+  int offset = sizeof(dns_header_t);
+  while (offset < len && query[offset] && !(query[offset] & 0xC0)) offset += query[offset] + 1;
+  int nameLen = offset + 1 - sizeof(dns_header_t);
+  if (offset + 4 >= len || query[offset] || nameLen > UINT8_MAX) return; // malformed
+  CaptureRecord rec = {(uint32_t)millis(), clientIP, (uint16_t)((query[offset + 1] << 8) | query[offset + 2]),
+    (uint8_t)(isTcp ? CAPTURE_TCP : 0), (uint8_t)nameLen};
+  size_t recLen = sizeof(rec) + nameLen;
+  taskENTER_CRITICAL(&captureMux);
+  // make space by dropping oldest records
+  while (captureSize - captureUsed < recLen) {
+    size_t oldLen = sizeof(rec) + captureBuf[(captureTail + offsetof(CaptureRecord, nameLen)) % captureSize];
+    captureTail = (captureTail + oldLen) % captureSize;
+    captureUsed -= oldLen;
+    captureCnt--;
+  }
+  ringWrite((const uint8_t*)&rec, sizeof(rec));
+  ringWrite(query + sizeof(dns_header_t), nameLen);
+  captureUsed += recLen;
+  captureCnt++;
+  captureTotal++;
+  taskEXIT_CRITICAL(&captureMux);
+}
+
+esp_err_t sendCapture(httpd_req_t* req) {
+  // download captured queries, with capture paused so that ring contents are stable
+  if (captureBuf == NULL) {
+    httpd_resp_set_status(req, "404 Query capture not enabled");
+    return httpd_resp_sendstr(req, NULL);
+  }
+  taskENTER_CRITICAL(&captureMux);
+  capturePaused = true;
+  CaptureHeader hdr = {CAPTURE_MAGIC, CAPTURE_VERSION, sizeof(CaptureRecord), captureCnt, (uint32_t)captureUsed};
+  size_t pos = captureTail;
+  taskEXIT_CRITICAL(&captureMux);
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=capture.bin");
+  esp_err_t res = httpd_resp_send_chunk(req, (const char*)&hdr, sizeof(hdr));
+  size_t left = hdr.bytes;
+  while (left && res == ESP_OK) {
+    size_t chunkSize = min(min(left, (size_t)CHUNKSIZE), captureSize - pos);
+    res = httpd_resp_send_chunk(req, (const char*)captureBuf + pos, chunkSize);
+    pos = (pos + chunkSize) % captureSize;
+    left -= chunkSize;
+  }
+  if (res == ESP_OK) httpd_resp_sendstr_chunk(req, NULL);
+  capturePaused = false;
+  LOG_INF("Query capture of %lu queries %s", hdr.records, res == ESP_OK ? "downloaded" : "download failed");
+  return res;
+}
+
+static void updateCaptureStats() {
+  if (captureBuf == NULL) return;
+  char statsStr[FILE_NAME_LEN];
+  taskENTER_CRITICAL(&captureMux);
+  uint32_t held = captureCnt, total = captureTotal;
+  size_t used = captureUsed;
+  taskEXIT_CRITICAL(&captureMux);
+  snprintf(statsStr, sizeof(statsStr), "%lu / %lu, %u%% used", held, total, (unsigned)(used * 100 / captureSize));
+  updateConfigVect("dnsCaptured", statsStr);
+}
+
+/**************************** Metrics ****************************/
+
+// counters and histograms in Prometheus text format at /metrics, for scraping without
+// the config vector or jsonBuff. Hot path updates are single atomic increments
+
+#define METRICS_BUF_LEN 1024 // rendered in chunks of this size
+#define METRICS_LINE_LEN 192 // max rendered line
+#define HIST_BOUNDS 18
+
+enum metricsQtype {MQ_A, MQ_AAAA, MQ_HTTPS, MQ_PTR, MQ_TXT, MQ_SRV, MQ_MX, MQ_OTHER, MQ_COUNT};
+static const char* qtypeLabels[MQ_COUNT] = {"A", "AAAA", "HTTPS", "PTR", "TXT", "SRV", "MX", "other"};
+static const char* verdictLabels[VERDICT_COUNT] = {"allowed", "blocked", "local", "error"};
+
+// bucket upper bounds in us, shared by all histograms
+static const uint32_t histBounds[HIST_BOUNDS] = {5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000,
+  10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+
+struct Histogram {
+  const char* name;
+  const char* help;
+  uint32_t buckets[HIST_BOUNDS + 1]; // last is +Inf, not cumulative
+  uint64_t sumUs;
+};
+static Histogram histograms[HIST_COUNT] = {
+  {"adblocker_blocklist_lookup_seconds", "Blocklist search time"},
+  {"adblocker_upstream_latency_seconds", "Upstream DNS response time, ms resolution"},
+  {"adblocker_queue_wait_seconds", "Time query waited for a DNS worker"}};
+
+static uint32_t queryCounts[MQ_COUNT][VERDICT_COUNT];
+
+static int qtypeIndex(uint16_t qtype) {
+  switch (qtype) {
+    case DNS_TYPE_A: return MQ_A;
+    case DNS_TYPE_AAAA: return MQ_AAAA;
+    case DNS_TYPE_HTTPS: return MQ_HTTPS;
+    case DNS_TYPE_PTR: return MQ_PTR;
+    case DNS_TYPE_TXT: return MQ_TXT;
+    case DNS_TYPE_SRV: return MQ_SRV;
+    case DNS_TYPE_MX: return MQ_MX;
+    default: return MQ_OTHER;
+  }
+}
+
+static void metricsQuery(uint16_t qtype, uint8_t verdict) {
+  Atomic_Increment_u32(&queryCounts[qtypeIndex(qtype)][verdict]);
+}
+
+void metricsObserve(uint8_t hist, uint32_t us) {
+  // add sample to histogram, bucket found by linear search as most samples are in first few
+  Histogram* h = histograms + hist;
+  int i = 0;
+  while (i < HIST_BOUNDS && us > histBounds[i]) i++;
+  Atomic_Increment_u32(&h->buckets[i]);
+  __atomic_fetch_add(&h->sumUs, us, __ATOMIC_RELAXED);
+}
+
+// formatted text output, sent as chunked response or written to file
+struct MetricsOut {
+  httpd_req_t* req;
+  File* file;
+  char buf[METRICS_BUF_LEN];
+  int len;
+  esp_err_t res;
+};
+
+static MetricsOut* metricsOpen(httpd_req_t* req, File* file = NULL) {
+  MetricsOut* out = (MetricsOut*)malloc(sizeof(MetricsOut));
+  if (out == NULL) return NULL;
+  out->req = req;
+  out->file = file;
+  out->len = 0;
+  out->res = ESP_OK;
+  return out;
+}
+
+static void metricsFlush(MetricsOut* out) {
+  if (out->len && out->res == ESP_OK) {
+    if (out->req != NULL) out->res = httpd_resp_send_chunk(out->req, out->buf, out->len);
+    else if (out->file->write((const uint8_t*)out->buf, out->len) != (size_t)out->len) out->res = ESP_FAIL;
+  }
+  out->len = 0;
+}
+
+static void metricsPrint(MetricsOut* out, const char* format, ...) {
+  // append formatted line to buffer, sending buffer when nearly full
+  if (METRICS_BUF_LEN - out->len < METRICS_LINE_LEN) metricsFlush(out);
+  va_list arglist;
+  va_start(arglist, format);
+  int len = vsnprintf(out->buf + out->len, METRICS_BUF_LEN - out->len, format, arglist);
+  va_end(arglist);
+  if (len > 0) out->len = min(out->len + len, METRICS_BUF_LEN - 1);
+}
+
+static void metricsCounter(MetricsOut* out, const char* name, const char* help, uint32_t value) {
+  metricsPrint(out, "# HELP %s %s\n# TYPE %s counter\n%s %lu\n", name, help, name, name, value);
+}
+
+static void metricsGauge(MetricsOut* out, const char* name, const char* help, double value) {
+  metricsPrint(out, "# HELP %s %s\n# TYPE %s gauge\n%s %.6g\n", name, help, name, name, value);
+}
+
+static void metricsHistogram(MetricsOut* out, Histogram* h) {
+  metricsPrint(out, "# HELP %s %s\n# TYPE %s histogram\n", h->name, h->help, h->name);
+  uint32_t cumulative = 0;
+  for (int i = 0; i <= HIST_BOUNDS; i++) {
+    cumulative += h->buckets[i];
+    if (i < HIST_BOUNDS) metricsPrint(out, "%s_bucket{le=\"%g\"} %lu\n", h->name, histBounds[i] / 1e6, cumulative);
+    else metricsPrint(out, "%s_bucket{le=\"+Inf\"} %lu\n", h->name, cumulative);
+  }
+  metricsPrint(out, "%s_sum %.6f\n%s_count %lu\n", h->name, h->sumUs / 1e6, h->name, cumulative);
+}
+
+static void metricsTasks(MetricsOut* out) {
+  // cumulative cpu time and free stack of each task
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  UBaseType_t taskCnt = uxTaskGetNumberOfTasks() + 4; // allow for tasks started meanwhile
+  TaskStatus_t* tasks = (TaskStatus_t*)malloc(taskCnt * sizeof(TaskStatus_t));
+  if (tasks == NULL) return;
+  configRUN_TIME_COUNTER_TYPE runCounter;
+  taskCnt = uxTaskGetSystemState(tasks, taskCnt, &runCounter);
+  metricsPrint(out, "# HELP adblocker_task_cpu_seconds_total Task run time\n# TYPE adblocker_task_cpu_seconds_total counter\n");
+  for (int i = 0; i < taskCnt; i++)
+    metricsPrint(out, "adblocker_task_cpu_seconds_total{task=\"%s\"} %.6f\n", tasks[i].pcTaskName,
+      tasks[i].ulRunTimeCounter / 1e6); // run time clock is esp_timer in us
+  metricsPrint(out, "# HELP adblocker_task_stack_free_bytes Task minimum free stack\n# TYPE adblocker_task_stack_free_bytes gauge\n");
+  for (int i = 0; i < taskCnt; i++)
+    metricsPrint(out, "adblocker_task_stack_free_bytes{task=\"%s\"} %lu\n", tasks[i].pcTaskName,
+      (uint32_t)tasks[i].usStackHighWaterMark);
+  free(tasks);
+#endif
+}
+
+esp_err_t metricsHandler(httpd_req_t* req) {
+  // render all metrics as chunked response
+  MetricsOut* out = metricsOpen(req);
+  if (out == NULL) return httpd_resp_send_500(req);
+  httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+  metricsPrint(out, "# HELP adblocker_queries_total Queries answered by type and verdict\n# TYPE adblocker_queries_total counter\n");
+  for (int q = 0; q < MQ_COUNT; q++) {
+    for (int v = 0; v < VERDICT_COUNT; v++) {
+      if (queryCounts[q][v]) metricsPrint(out, "adblocker_queries_total{qtype=\"%s\",verdict=\"%s\"} %lu\n",
+        qtypeLabels[q], verdictLabels[v], queryCounts[q][v]);
+    }
+  }
+  metricsCounter(out, "adblocker_cache_hits_total", "Queries answered from cache", cacheHits);
+  metricsCounter(out, "adblocker_cache_misses_total", "Queries not in cache", cacheMisses);
+  metricsCounter(out, "adblocker_stale_answers_total", "Queries answered from expired cache", staleCnt);
+  metricsCounter(out, "adblocker_upstream_lookups_total", "Lookups sent upstream", upstreamCnt);
+  metricsCounter(out, "adblocker_coalesced_total", "Queries answered by identical lookup in progress", coalescedCnt);
+  metricsCounter(out, "adblocker_prefetch_total", "Popular names refreshed before expiry", prefetchCnt);
+  metricsCounter(out, "adblocker_servfail_total", "Queries that could not be resolved", servfailCnt);
+  metricsCounter(out, "adblocker_rate_limited_total", "Queries dropped or refused by rate limiting", rateLimitedCnt);
+  metricsCounter(out, "adblocker_queue_drops_total", "Queries dropped as queue full", dnsDrops);
+  logStats_t logStats;
+  getLogStats(&logStats);
+  metricsCounter(out, "adblocker_log_messages_total", "Log messages output", logStats.messages);
+  metricsCounter(out, "adblocker_log_bytes_total", "Log bytes output", logStats.bytes);
+  metricsCounter(out, "adblocker_log_batches_total", "Log batches output, one write per recipient", logStats.batches);
+  metricsCounter(out, "adblocker_log_drops_total", "Log messages dropped as log ring full", logStats.dropped);
+
+  // per upstream server
+  Upstream ups[NUM_UPSTREAMS];
+  taskENTER_CRITICAL(&upstreamMux);
+  memcpy(ups, upstreams, sizeof(ups));
+  taskEXIT_CRITICAL(&upstreamMux);
+  metricsPrint(out, "# HELP adblocker_upstream_queries_total Queries sent to upstream server\n# TYPE adblocker_upstream_queries_total counter\n");
+  for (int i = 0; i < NUM_UPSTREAMS; i++)
+    if (ups[i].valid) metricsPrint(out, "adblocker_upstream_queries_total{server=\"%s\"} %lu\n", ups[i].ip, ups[i].queries);
+  metricsPrint(out, "# HELP adblocker_upstream_errors_total Upstream timeouts and failures\n# TYPE adblocker_upstream_errors_total counter\n");
+  for (int i = 0; i < NUM_UPSTREAMS; i++)
+    if (ups[i].valid) metricsPrint(out, "adblocker_upstream_errors_total{server=\"%s\"} %lu\n", ups[i].ip, ups[i].errors);
+  metricsPrint(out, "# HELP adblocker_upstream_srtt_seconds Smoothed upstream round trip time\n# TYPE adblocker_upstream_srtt_seconds gauge\n");
+  for (int i = 0; i < NUM_UPSTREAMS; i++)
+    if (ups[i].valid) metricsPrint(out, "adblocker_upstream_srtt_seconds{server=\"%s\"} %.4f\n", ups[i].ip, ups[i].srtt / 1000.0);
+
+  for (int i = 0; i < HIST_COUNT; i++) metricsHistogram(out, histograms + i);
+  metricsGauge(out, "adblocker_queue_depth", "Queries waiting for a DNS worker", dnsQueue ? uxQueueMessagesWaiting(dnsQueue) : 0);
+  metricsGauge(out, "adblocker_queue_peak_depth", "Peak queries waiting since restart", peakDepth);
+  metricsGauge(out, "adblocker_log_ring_peak_bytes", "Peak log ring use since restart", logStats.peakUsed);
+  metricsGauge(out, "adblocker_log_ring_bytes", "Log ring size", logStats.ringLen);
+  metricsGauge(out, "adblocker_heap_free_bytes", "Free internal heap", ESP.getFreeHeap());
+  metricsGauge(out, "adblocker_heap_min_free_bytes", "Lowest free internal heap", ESP.getMinFreeHeap());
+  metricsGauge(out, "adblocker_heap_max_alloc_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+  metricsGauge(out, "adblocker_psram_free_bytes", "Free PSRAM", ESP.getFreePsram());
+  metricsGauge(out, "adblocker_uptime_seconds", "Time since restart", esp_timer_get_time() / 1e6);
+  metricsTasks(out);
+
+  metricsFlush(out);
+  esp_err_t res = out->res;
+  free(out);
+  if (res == ESP_OK) res = httpd_resp_send_chunk(req, NULL, 0);
+  else LOG_WRN("Failed to send metrics, err %s", espErrMsg(res));
+  return res;
+}
+
+/*************************** Query Log ***************************/
+
+// outcome of each query held as fixed size records in a ring buffer in psram, written
+// without locks by DNS workers, and exported as CSV or NDJSON, or saved to storage
+// in segments as the ring fills so that a longer history is kept
+
+#define QLOG_NAME_LEN 44 // longer names truncated
+#define QLOG_SEGMENTS 4 // ring divided into segments for saving to storage
+#define QLOG_FILES 8 // segment files kept in storage, oldest overwritten
+#define QLOG_DIR "/qlog"
+#define QLOG_ROLL_MS 1000 // interval to check for filled segments
+#define QLOG_PRI 1
+
+struct QueryLogRecord {
+  uint32_t seq; // record number + 1, written last, so incomplete or overwritten records can be skipped
+  uint32_t ms; // time query received
+  uint32_t clientIP; // network byte order
+  uint32_t latencyUs; // from query received to response sent
+  uint16_t qtype;
+  uint8_t verdict;
+  uint8_t flags;
+  char name[QLOG_NAME_LEN]; // sanitised for CSV and JSON
+};
+
+uint16_t dnsQueryLog = 0; // KB of psram for query log, 0 to disable, applied on restart
+bool dnsQueryRoll = false; // save segments to storage
+static QueryLogRecord* qlogBuf = NULL;
+static uint32_t qlogRecords = 0; // capacity, a multiple of QLOG_SEGMENTS
+static uint32_t qlogHead = 0; // next record number
+static uint32_t qlogRolled = 0; // next record number to save to storage
+static uint32_t qlogSaved = 0; // segments saved
+static uint32_t qlogMissed = 0; // records overwritten before saved
+
+static void prepQueryLog() {
+  if (!dnsQueryLog) return;
+  qlogRecords = dnsQueryLog * 1024 / sizeof(QueryLogRecord) / QLOG_SEGMENTS * QLOG_SEGMENTS;
+  if (qlogRecords) qlogBuf = (QueryLogRecord*)ps_calloc(qlogRecords, sizeof(QueryLogRecord));
+  if (qlogBuf == NULL) LOG_WRN("Insufficient memory for %uKB query log", dnsQueryLog);
+  else {
+    if (dnsQueryRoll) {
+      STORAGE.mkdir(QLOG_DIR);
+      xTaskCreate(qlogTask, "dnsQlog", DNS_STACK_SIZE, NULL, QLOG_PRI, NULL);
+    }
+    LOG_INF("Query log holding %lu queries", qlogRecords);
+  }
+}
+
+static void logQuery(dnsSlot_t* slot, const char* domain, uint8_t verdict, uint8_t flags) {
+  // record query outcome in metrics and query log, and in page counts if cloaked
+  metricsQuery(slot->qtype, verdict);
+  if (flags & QLOG_CLOAKED) countCloaked(domain, slot->clientIP);
+  if (qlogBuf == NULL) return;
+  uint32_t seq = __atomic_fetch_add(&qlogHead, 1, __ATOMIC_RELAXED);
+  QueryLogRecord* rec = qlogBuf + seq % qlogRecords;
+  __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED); // being written
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  rec->latencyUs = micros() - slot->queuedUs;
+  rec->ms = millis() - rec->latencyUs / 1000;
+  rec->clientIP = slot->clientIP;
+  rec->qtype = slot->qtype;
+  rec->verdict = verdict;
+  rec->flags = flags | (slot->tcpConn >= 0 ? QLOG_TCP : 0);
+  int i = 0;
+  for (; i < QLOG_NAME_LEN - 1 && domain[i]; i++) {
+    char c = domain[i];
+    rec->name[i] = (c > ' ' && c < 0x7F && c != '"' && c != '\\' && c != ',') ? c : '?';
+  }
+  rec->name[i] = 0;
+  __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static bool readQueryLog(uint32_t seq, QueryLogRecord* rec) {
+  // copy record, returning false if overwritten or being written
+  QueryLogRecord* src = qlogBuf + seq % qlogRecords;
+  if (__atomic_load_n(&src->seq, __ATOMIC_ACQUIRE) != seq + 1) return false;
+  memcpy(rec, src, sizeof(QueryLogRecord));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&src->seq, __ATOMIC_RELAXED) == seq + 1;
+}
+
+static void printQueryLog(MetricsOut* out, uint32_t first, uint32_t last, bool asJson) {
+  // format records from first to before last
+  static const char* flagNames[] = {"tcp", "cached", "coalesced", "cloaked"};
+  // convert ms since boot to epoch ms
+  uint64_t bootMs = (uint64_t)getEpoch() * 1000 - millis();
+  if (!asJson) metricsPrint(out, "time,client,qtype,verdict,latency_us,flags,domain\n");
+  QueryLogRecord rec;
+  for (uint32_t seq = first; seq != last && out->res == ESP_OK; seq++) {
+    if (!readQueryLog(seq, &rec)) continue;
+    char qtype[8];
+    int qIdx = qtypeIndex(rec.qtype);
+    if (qIdx == MQ_OTHER) snprintf(qtype, sizeof(qtype), "%u", rec.qtype);
+    else strcpy(qtype, qtypeLabels[qIdx]);
+    char flags[32] = "";
+    for (int i = 0, pos = 0; i < 4; i++)
+      if (rec.flags & (1 << i)) pos += sprintf(flags + pos, "%s%s", pos ? "|" : "", flagNames[i]);
+    uint64_t timeMs = bootMs + rec.ms;
+    char clientIP[MAX_IP_LEN];
+    strcpy(clientIP, IPAddress(rec.clientIP).toString().c_str());
+    if (asJson) metricsPrint(out, "{\"time\":%llu.%03u,\"client\":\"%s\",\"qtype\":\"%s\",\"verdict\":\"%s\","
+      "\"latency_us\":%lu,\"flags\":\"%s\",\"domain\":\"%s\"}\n", timeMs / 1000, (unsigned)(timeMs % 1000), clientIP,
+      qtype, verdictLabels[rec.verdict], rec.latencyUs, flags, rec.name);
+    else metricsPrint(out, "%llu.%03u,%s,%s,%s,%lu,%s,%s\n", timeMs / 1000, (unsigned)(timeMs % 1000), clientIP,
+      qtype, verdictLabels[rec.verdict], rec.latencyUs, flags, rec.name);
+  }
+  metricsFlush(out);
+}
+
+esp_err_t sendQueryLog(httpd_req_t* req, bool asJson) {
+  // download query log as CSV or NDJSON, oldest first, while logging continues
+  if (qlogBuf == NULL) {
+    httpd_resp_set_status(req, "404 Query log not enabled");
+    return httpd_resp_sendstr(req, NULL);
+  }
+  MetricsOut* out = metricsOpen(req);
+  if (out == NULL) return httpd_resp_send_500(req);
+  uint32_t last = __atomic_load_n(&qlogHead, __ATOMIC_ACQUIRE);
+  uint32_t first = last > qlogRecords ? last - qlogRecords : 0;
+  httpd_resp_set_type(req, asJson ? "application/x-ndjson" : "text/csv");
+  httpd_resp_set_hdr(req, "Content-Disposition", asJson ? "attachment; filename=querylog.json" : "attachment; filename=querylog.csv");
+  printQueryLog(out, first, last, asJson);
+  esp_err_t res = out->res;
+  free(out);
+  if (res == ESP_OK) res = httpd_resp_sendstr_chunk(req, NULL);
+  LOG_INF("Query log of %lu queries %s", last - first, res == ESP_OK ? "downloaded" : "download failed");
+  return res;
+}
+
+static void rollQueryLog() {
+  // save each filled segment of ring to a CSV file in storage
+  uint32_t segRecords = qlogRecords / QLOG_SEGMENTS;
+  uint32_t head = __atomic_load_n(&qlogHead, __ATOMIC_ACQUIRE);
+  if (head - qlogRolled > qlogRecords - segRecords) {
+    // segments overwritten, or about to be, before saved
+    uint32_t next = (head - (qlogRecords - segRecords) + segRecords - 1) / segRecords * segRecords;
+    qlogMissed += next - qlogRolled;
+    qlogRolled = next;
+  }
+  while (head - qlogRolled >= segRecords) {
+    char path[FILE_NAME_LEN];
+    snprintf(path, sizeof(path), QLOG_DIR "/ql%lu.csv", qlogSaved % QLOG_FILES);
+    File file = STORAGE.open(path, FILE_WRITE);
+    MetricsOut* out = file ? metricsOpen(NULL, &file) : NULL;
+    if (out != NULL) {
+      printQueryLog(out, qlogRolled, qlogRolled + segRecords, false);
+      if (out->res != ESP_OK) LOG_WRN("Failed to write %s", path);
+      free(out);
+    } else LOG_WRN("Failed to open %s", path);
+    if (file) file.close();
+    qlogRolled += segRecords;
+    qlogSaved++;
+  }
+}
+
+static void qlogTask(void* arg) {
+  // low priority task saving filled segments, so storage writes are off the DNS path
+  while (true) {
+    delay(QLOG_ROLL_MS);
+    rollQueryLog();
+  }
+}
+
+static void updateQueryLogStats() {
+  if (qlogBuf == NULL) return;
+  char statsStr[FILE_NAME_LEN];
+  uint32_t total = __atomic_load_n(&qlogHead, __ATOMIC_RELAXED);
+  int pos = snprintf(statsStr, sizeof(statsStr), "%lu / %lu", min(total, qlogRecords), total);
+  if (dnsQueryRoll) snprintf(statsStr + pos, sizeof(statsStr) - pos, ", saved %lu, missed %lu", qlogSaved, qlogMissed);
+  updateConfigVect("dnsQueryLogged", statsStr);
+}
+
+/************************* Task Profile **************************/
+
+// rolling history of per task cpu % and free stack, with free memory and DNS latency,
+// sampled by a low priority task and served as compact JSON for the Profile tab graphs,
+// so that latency spikes can be matched to activity of other tasks
+
+#define PROFILE_SAMPLES 120 // history kept
+#define PROFILE_TASKS 20 // task columns
+#define PROFILE_NAME_LEN 16 // as configMAX_TASK_NAME_LEN
+#define PROFILE_NONE 0xFFFF // task not running for sample
+#define PROFILE_PRI 1
+
+struct ProfileSample {
+  uint32_t secs; // since restart
+  uint32_t heapFree;
+  uint32_t psramFree;
+  uint32_t maxBlock; // largest free heap block
+  uint32_t queries; // in interval
+  uint32_t upstreamUs; // average in interval
+  uint32_t waitUs; // average queue wait in interval
+  uint16_t cpu[PROFILE_TASKS]; // tenths of % of a core
+  uint16_t stack[PROFILE_TASKS]; // min free stack bytes
+};
+
+enum profileField {PF_SECS, PF_HEAP, PF_PSRAM, PF_BLOCK, PF_QUERIES, PF_UPSTREAM, PF_WAIT, PF_CPU, PF_STACK};
+
+uint16_t dnsProfile = 5; // secs between samples, 0 to disable, applied on restart
+static ProfileSample* profileBuf = NULL;
+static uint32_t profileHead = 0; // next sample number
+static char profileNames[PROFILE_TASKS][PROFILE_NAME_LEN];
+static uint8_t profileTasks = 0; // columns in use
+
+static uint32_t histCount(uint8_t hist) {
+  uint32_t count = 0;
+  for (int i = 0; i <= HIST_BOUNDS; i++) count += histograms[hist].buckets[i];
+  return count;
+}
+
+static uint32_t histAverage(uint8_t hist, uint32_t* prevCount, uint64_t* prevSum) {
+  // average of observations since previous call
+  uint32_t count = histCount(hist);
+  uint64_t sum = __atomic_load_n(&histograms[hist].sumUs, __ATOMIC_RELAXED);
+  uint32_t avg = count > *prevCount ? (sum - *prevSum) / (count - *prevCount) : 0;
+  *prevCount = count;
+  *prevSum = sum;
+  return avg;
+}
+
+static void profileSample(ProfileSample* s) {
+  static uint32_t prevQueries = 0, prevUpstreams = 0, prevWaits = 0;
+  static uint64_t prevUpstreamUs = 0, prevWaitUs = 0;
+  s->secs = esp_timer_get_time() / 1000000;
+  s->heapFree = ESP.getFreeHeap();
+  s->psramFree = ESP.getFreePsram();
+  s->maxBlock = ESP.getMaxAllocHeap();
+  uint32_t queries = 0;
+  for (int q = 0; q < MQ_COUNT; q++)
+    for (int v = 0; v < VERDICT_COUNT; v++) queries += queryCounts[q][v];
+  s->queries = queries - prevQueries;
+  prevQueries = queries;
+  s->upstreamUs = histAverage(HIST_UPSTREAM, &prevUpstreams, &prevUpstreamUs);
+  s->waitUs = histAverage(HIST_QUEUE_WAIT, &prevWaits, &prevWaitUs);
+  for (int i = 0; i < PROFILE_TASKS; i++) s->cpu[i] = s->stack[i] = PROFILE_NONE;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  static TaskHandle_t profileHandles[PROFILE_TASKS];
+  static configRUN_TIME_COUNTER_TYPE prevTotal = 0;
+  static configRUN_TIME_COUNTER_TYPE prevRun[PROFILE_TASKS];
+  UBaseType_t taskCnt = uxTaskGetNumberOfTasks() + 4; // allow for tasks started meanwhile
+  TaskStatus_t* tasks = (TaskStatus_t*)malloc(taskCnt * sizeof(TaskStatus_t));
+  if (tasks == NULL) return;
+  configRUN_TIME_COUNTER_TYPE total;
+  taskCnt = uxTaskGetSystemState(tasks, taskCnt, &total);
+  configRUN_TIME_COUNTER_TYPE elapsed = total - prevTotal;
+  for (int i = 0; i < taskCnt; i++) {
+    // tasks keep same column, new tasks added while columns left
+    int col = 0;
+    while (col < profileTasks && profileHandles[col] != tasks[i].xHandle) col++;
+    if (col == profileTasks) {
+      if (col == PROFILE_TASKS) continue;
+      snprintf(profileNames[col], PROFILE_NAME_LEN, "%s", tasks[i].pcTaskName);
+      profileHandles[col] = tasks[i].xHandle;
+      prevRun[col] = tasks[i].ulRunTimeCounter;
+      __atomic_store_n(&profileTasks, col + 1, __ATOMIC_RELEASE);
+    }
+    if (prevTotal && elapsed) s->cpu[col] = min((tasks[i].ulRunTimeCounter - prevRun[col]) * 1000ULL / elapsed, 1000ULL);
+    prevRun[col] = tasks[i].ulRunTimeCounter;
+    // high water mark already taken by uxTaskGetSystemState(), so no further stack scan or logging
+    s->stack[col] = min((uint32_t)tasks[i].usStackHighWaterMark, (uint32_t)PROFILE_NONE - 1);
+  }
+  prevTotal = total;
+  free(tasks);
+#endif
+}
+
+static void profileTask(void* arg) {
+  // sample at fixed interval into ring of samples
+  while (true) {
+    delay(dnsProfile * 1000);
+    profileSample(profileBuf + profileHead % PROFILE_SAMPLES);
+    __atomic_store_n(&profileHead, profileHead + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void prepProfile() {
+  if (!dnsProfile) return;
+  profileBuf = (ProfileSample*)ps_malloc(PROFILE_SAMPLES * sizeof(ProfileSample));
+  if (profileBuf == NULL) LOG_WRN("Insufficient memory for task profile");
+  else {
+    xTaskCreate(profileTask, "dnsProfile", DNS_STACK_SIZE, NULL, PROFILE_PRI, NULL);
+    LOG_INF("Task profile sampled every %us for %us", dnsProfile, dnsProfile * PROFILE_SAMPLES);
+  }
+}
+
+static uint32_t profileValue(ProfileSample* s, uint8_t field, int col) {
+  switch (field) {
+    case PF_SECS: return s->secs;
+    case PF_HEAP: return s->heapFree;
+    case PF_PSRAM: return s->psramFree;
+    case PF_BLOCK: return s->maxBlock;
+    case PF_QUERIES: return s->queries;
+    case PF_UPSTREAM: return s->upstreamUs;
+    case PF_WAIT: return s->waitUs;
+    case PF_CPU: return s->cpu[col];
+    default: return s->stack[col];
+  }
+}
+
+static void profileSeries(MetricsOut* out, const char* key, uint32_t first, uint32_t last, uint8_t field, int col = 0) {
+  // output field of each sample as JSON array, with cpu in % to 1 decimal
+  metricsPrint(out, "\"%s\":[", key);
+  for (uint32_t seq = first; seq != last; seq++) {
+    uint32_t val = profileValue(profileBuf + seq % PROFILE_SAMPLES, field, col);
+    const char* sep = seq == first ? "" : ",";
+    if (field >= PF_CPU && val == PROFILE_NONE) metricsPrint(out, "%snull", sep);
+    else if (field == PF_CPU) metricsPrint(out, "%s%lu.%lu", sep, val / 10, val % 10);
+    else metricsPrint(out, "%s%lu", sep, val);
+  }
+  metricsPrint(out, "]");
+}
+
+esp_err_t sendProfile(httpd_req_t* req) {
+  // send sample history as JSON arrays, oldest first
+  if (profileBuf == NULL) {
+    httpd_resp_set_status(req, "404 Task profile not enabled");
+    return httpd_resp_sendstr(req, NULL);
+  }
+  MetricsOut* out = metricsOpen(req);
+  if (out == NULL) return httpd_resp_send_500(req);
+  httpd_resp_set_type(req, "application/json");
+  uint32_t last = __atomic_load_n(&profileHead, __ATOMIC_ACQUIRE);
+  // skip oldest sample as may be overwritten while sending
+  uint32_t first = last >= PROFILE_SAMPLES ? last - PROFILE_SAMPLES + 1 : 0;
+  uint8_t taskCnt = __atomic_load_n(&profileTasks, __ATOMIC_ACQUIRE);
+  metricsPrint(out, "{\"interval\":%u,\"cores\":%u,", dnsProfile, CONFIG_FREERTOS_NUMBER_OF_CORES);
+  profileSeries(out, "t", first, last, PF_SECS);
+  metricsPrint(out, ",");
+  profileSeries(out, "heap", first, last, PF_HEAP);
+  metricsPrint(out, ",");
+  profileSeries(out, "psram", first, last, PF_PSRAM);
+  metricsPrint(out, ",");
+  profileSeries(out, "block", first, last, PF_BLOCK);
+  metricsPrint(out, ",");
+  profileSeries(out, "queries", first, last, PF_QUERIES);
+  metricsPrint(out, ",");
+  profileSeries(out, "upstreamUs", first, last, PF_UPSTREAM);
+  metricsPrint(out, ",");
+  profileSeries(out, "waitUs", first, last, PF_WAIT);
+  metricsPrint(out, ",\"tasks\":[");
+  for (int col = 0; col < taskCnt; col++) {
+    metricsPrint(out, "%s{\"name\":\"%s\",", col ? "," : "", profileNames[col]);
+    profileSeries(out, "cpu", first, last, PF_CPU, col);
+    metricsPrint(out, ",");
+    profileSeries(out, "stack", first, last, PF_STACK, col);
+    metricsPrint(out, "}");
+  }
+  metricsPrint(out, "]}");
+  metricsFlush(out);
+  esp_err_t res = out->res;
+  free(out);
+  if (res == ESP_OK) res = httpd_resp_sendstr_chunk(req, NULL);
+  return res;
+}
@@ -0,0 +1,79 @@
+// Common functions for dnsLoad and dnsReplay benchmark tools
+//
+// s60sc 2026
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#define DNS_HEADER_LEN 12
+#define MAX_MSG_LEN 512
+#define MAX_IDS 65536 // DNS IDs, so max queries in flight
+#define RCODE_NXDOMAIN 3
+
+struct Results {
+  uint64_t sent = 0;
+  uint64_t answered = 0;
+  uint64_t unexpected = 0; // answer inconsistent with expected verdict
+  uint64_t rcodes[16] = {0};
+  std::vector<uint32_t> latencyUs;
+};
+
+static inline uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline bool isSinkhole(const uint8_t* msg, int len) {
+  // true if answer contains an all zero A or AAAA address, as used for blocked names
+  int ancount = (msg[6] << 8) | msg[7];
+  int pos = DNS_HEADER_LEN;
+  while (pos < len && msg[pos]) pos += msg[pos] + 1; // question name
+  pos += 5;
+  for (int i = 0; i < ancount && pos < len; i++) {
+    while (pos < len && msg[pos] && !(msg[pos] & 0xC0)) pos += msg[pos] + 1;
+    pos += (pos < len && (msg[pos] & 0xC0)) ? 2 : 1;
+    if (pos + 10 > len) break;
+    uint16_t type = (msg[pos] << 8) | msg[pos + 1];
+    uint16_t rdLen = (msg[pos + 8] << 8) | msg[pos + 9];
+    pos += 10;
+    if (pos + rdLen > len) break;
+    if ((type == 1 && rdLen == 4) || (type == 28 && rdLen == 16)) {
+      bool zero = true;
+      for (int j = 0; j < rdLen; j++) zero &= !msg[pos + j];
+      return zero;
+    }
+    pos += rdLen;
+  }
+  return false;
+}
+
+static inline double percentile(const std::vector<uint32_t>& sorted, double pct) {
+  // in ms
+  if (sorted.empty()) return 0;
+  size_t idx = std::min((size_t)(pct / 100.0 * sorted.size()), sorted.size() - 1);
+  return sorted[idx] / 1000.0;
+}
+
+static inline void printResultsHeader(const char* label) {
+  printf("%-8s %9s %9s %8s %9s %9s %9s %9s %7s %7s %10s\n", label, "sent", "answered", "loss%",
+    "p50 ms", "p99 ms", "p999 ms", "max ms", "NXDOM", "other", "unexpected");
+}
+
+static inline double printResults(const char* label, Results& res) {
+  // output row of results, returning p99 latency
+  std::sort(res.latencyUs.begin(), res.latencyUs.end());
+  uint64_t otherRcodes = res.answered - res.rcodes[0] - res.rcodes[RCODE_NXDOMAIN];
+  double p99 = percentile(res.latencyUs, 99);
+  printf("%-8s %9llu %9llu %8.2f %9.2f %9.2f %9.2f %9.2f %7llu %7llu %10llu\n", label,
+    (unsigned long long)res.sent, (unsigned long long)res.answered,
+    res.sent ? (res.sent - res.answered) * 100.0 / res.sent : 0,
+    percentile(res.latencyUs, 50), p99, percentile(res.latencyUs, 99.9),
+    res.latencyUs.empty() ? 0 : res.latencyUs.back() / 1000.0,
+    (unsigned long long)res.rcodes[RCODE_NXDOMAIN], (unsigned long long)otherRcodes, (unsigned long long)res.unexpected);
+  return p99;
+}
@@ -0,0 +1,315 @@
+// DNS load generator and latency benchmark for the AdBlocker, either the host build or a board.
+// Sends a mix of blocked and allowed names, with Zipf distributed popularity and several
+// query types, at a fixed rate regardless of responses, so that queueing delays are measured.
+// Reports achieved rate, loss and latency percentiles for blocked and allowed names.
+//
+// Usage: dnsLoad [options], see usage()
+//
+// s60sc 2026
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include "dnsBench.h"
+
+enum Verdict {ALLOWED, BLOCKED, VERDICTS};
+static const char* verdictNames[VERDICTS] = {"allowed", "blocked"};
+
+struct QueryType {
+  const char* name;
+  uint16_t qtype;
+  uint32_t weight;
+};
+static std::vector<QueryType> qtypeMix;
+
+// one slot per DNS ID, so up to 65536 queries in flight
+struct Slot {
+  std::atomic<uint64_t> sentNs; // 0 if not in flight
+  uint8_t verdict;
+};
+static Slot slots[MAX_IDS];
+
+static Results results[VERDICTS];
+static std::atomic<bool> receiving(true);
+
+static void usage(const char* prog) {
+  printf("Usage: %s [options]\n"
+    "  -s addr[:port]   AdBlocker address (default 127.0.0.1:5353)\n"
+    "  -q qps           target queries per sec (default 1000)\n"
+    "  -d secs          test duration (default 10)\n"
+    "  -b file          blocklist file, in hosts or adblock format, to sample blocked names from\n"
+    "  -a file          allowed names, one per line (default generated names under load.test)\n"
+    "  -n count         number of generated allowed names (default 10000)\n"
+    "  -f fraction      fraction of queries for blocked names (default 0.2)\n"
+    "  -z exponent      Zipf exponent for name popularity (default 1.0)\n"
+    "  -t mix           query types and weights (default A:70,AAAA:25,HTTPS:5)\n"
+    "  -w ms            wait for responses before counting as lost (default 2000)\n"
+    "  -L percent       exit with failure if loss exceeds this\n"
+    "  -P ms            exit with failure if p99 latency exceeds this\n", prog);
+  exit(1);
+}
+
+static bool loadNames(const char* path, bool isBlocklist, std::vector<std::string>& names) {
+  // read names from file, for blocklist extract names as done by AdBlocker
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) return false;
+  char line[1024];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char* name = line;
+    if (isBlocklist) {
+      if (!strncmp(line, "127.0.0.1", 9) || !strncmp(line, "0.0.0.0", 7)) {
+        name = strpbrk(line, " \t");
+        if (name == NULL) continue;
+        name += strspn(name, " \t");
+      } else if (!strncmp(line, "||", 2)) name = line + 2;
+      else continue;
+    }
+    name[strcspn(name, " \t\r\n^#")] = 0;
+    if (strlen(name) && strcmp(name, "0.0.0.0") && strcmp(name, "localhost") && strchr(name, '.')) names.push_back(name);
+  }
+  fclose(fp);
+  return true;
+}
+
+static std::vector<double> zipfCdf(size_t count, double exponent) {
+  // cumulative distribution of name popularity by rank
+  std::vector<double> cdf(count);
+  double sum = 0;
+  for (size_t i = 0; i < count; i++) cdf[i] = (sum += 1.0 / pow(i + 1, exponent));
+  for (double& val : cdf) val /= sum;
+  return cdf;
+}
+
+static size_t zipfRank(const std::vector<double>& cdf, double uniform) {
+  return std::min((size_t)(std::lower_bound(cdf.begin(), cdf.end(), uniform) - cdf.begin()), cdf.size() - 1);
+}
+
+static bool parseMix(const char* mix) {
+  static const QueryType known[] = {{"A", 1, 0}, {"NS", 2, 0}, {"CNAME", 5, 0}, {"SOA", 6, 0}, {"PTR", 12, 0},
+    {"MX", 15, 0}, {"TXT", 16, 0}, {"AAAA", 28, 0}, {"SRV", 33, 0}, {"SVCB", 64, 0}, {"HTTPS", 65, 0}};
+  std::string str(mix);
+  size_t pos = 0;
+  while (pos < str.size()) {
+    size_t end = str.find(',', pos);
+    if (end == std::string::npos) end = str.size();
+    std::string item = str.substr(pos, end - pos);
+    size_t sep = item.find(':');
+    std::string name = item.substr(0, sep);
+    uint32_t weight = sep == std::string::npos ? 1 : atoi(item.c_str() + sep + 1);
+    bool found = false;
+    for (const QueryType& qt : known) {
+      if (!strcasecmp(qt.name, name.c_str())) {
+        qtypeMix.push_back({qt.name, qt.qtype, weight});
+        found = true;
+      }
+    }
+    if (!found) return false;
+    pos = end + 1;
+  }
+  return !qtypeMix.empty();
+}
+
+static int buildQuery(uint8_t* msg, uint16_t id, const std::string& name, uint16_t qtype) {
+  memset(msg, 0, DNS_HEADER_LEN);
+  msg[0] = id >> 8;
+  msg[1] = id & 0xFF;
+  msg[2] = 0x01; // recursion desired
+  msg[5] = 1; // qdcount
+  int pos = DNS_HEADER_LEN;
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t dot = name.find('.', start);
+    if (dot == std::string::npos) dot = name.size();
+    size_t labelLen = std::min(dot - start, (size_t)63);
+    if (pos + labelLen + 6 > MAX_MSG_LEN) break;
+    msg[pos++] = labelLen;
+    memcpy(msg + pos, name.data() + start, labelLen);
+    pos += labelLen;
+    start = dot + 1;
+  }
+  msg[pos++] = 0;
+  msg[pos++] = qtype >> 8;
+  msg[pos++] = qtype & 0xFF;
+  msg[pos++] = 0;
+  msg[pos++] = 1; // class IN
+  return pos;
+}
+
+static void receiveTask(int sock) {
+  uint8_t msg[MAX_MSG_LEN * 4];
+  while (receiving) {
+    struct pollfd pfd = {sock, POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0) continue;
+    int len = recv(sock, msg, sizeof(msg), 0);
+    uint64_t now = nowNs();
+    if (len < DNS_HEADER_LEN) continue;
+    uint16_t id = (msg[0] << 8) | msg[1];
+    Slot& slot = slots[id];
+    uint64_t sent = slot.sentNs.exchange(0);
+    if (!sent) continue; // late or duplicate response
+    Results& res = results[slot.verdict];
+    res.answered++;
+    uint8_t rcode = msg[3] & 0x0F;
+    res.rcodes[rcode]++;
+    res.latencyUs.push_back((now - sent) / 1000);
+    bool sinkhole = rcode == 0 && isSinkhole(msg, len);
+    if (slot.verdict == ALLOWED && sinkhole) res.unexpected++;
+    if (slot.verdict == BLOCKED && rcode == 0 && (msg[7] || msg[6]) && !sinkhole) res.unexpected++;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  char server[64] = "127.0.0.1";
+  uint16_t port = 5353;
+  double qps = 1000, duration = 10, blockedFraction = 0.2, exponent = 1.0;
+  const char* blocklistFile = NULL;
+  const char* allowedFile = NULL;
+  size_t allowedCount = 10000;
+  const char* mix = "A:70,AAAA:25,HTTPS:5";
+  uint32_t waitMs = 2000;
+  double maxLoss = -1, maxP99 = -1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:q:d:b:a:n:f:z:t:w:L:P:h")) != -1) {
+    switch (opt) {
+      case 's': {
+        char* sep = strchr(optarg, ':');
+        if (sep != NULL) {
+          *sep = 0;
+          port = atoi(sep + 1);
+        }
+        snprintf(server, sizeof(server), "%s", optarg);
+        break;
+      }
+      case 'q': qps = atof(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      case 'b': blocklistFile = optarg; break;
+      case 'a': allowedFile = optarg; break;
+      case 'n': allowedCount = atoi(optarg); break;
+      case 'f': blockedFraction = atof(optarg); break;
+      case 'z': exponent = atof(optarg); break;
+      case 't': mix = optarg; break;
+      case 'w': waitMs = atoi(optarg); break;
+      case 'L': maxLoss = atof(optarg); break;
+      case 'P': maxP99 = atof(optarg); break;
+      default: usage(argv[0]);
+    }
+  }
+  if (qps <= 0 || duration <= 0 || !parseMix(mix)) usage(argv[0]);
+
+  // name pools, shuffled so that popularity is independent of file order
+  std::mt19937_64 rng(12345); // fixed seed for repeatable runs
+  std::vector<std::string> names[VERDICTS];
+  if (blocklistFile != NULL && !loadNames(blocklistFile, true, names[BLOCKED])) {
+    printf("Cannot read blocklist %s\n", blocklistFile);
+    return 1;
+  }
+  if (allowedFile != NULL) {
+    if (!loadNames(allowedFile, false, names[ALLOWED])) {
+      printf("Cannot read allowed names %s\n", allowedFile);
+      return 1;
+    }
+  } else {
+    for (size_t i = 0; i < allowedCount; i++) names[ALLOWED].push_back("n" + std::to_string(i) + ".load.test");
+  }
+  if (names[BLOCKED].empty()) blockedFraction = 0;
+  if (names[ALLOWED].empty()) blockedFraction = 1;
+  std::vector<double> cdf[VERDICTS];
+  for (int v = 0; v < VERDICTS; v++) {
+    std::shuffle(names[v].begin(), names[v].end(), rng);
+    if (!names[v].empty()) cdf[v] = zipfCdf(names[v].size(), exponent);
+  }
+  uint32_t totalWeight = 0;
+  for (const QueryType& qt : qtypeMix) totalWeight += qt.weight;
+
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int bufSize = 4 * 1024 * 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, server, &addr.sin_addr) != 1 || connect(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+    printf("Invalid server address %s\n", server);
+    return 1;
+  }
+  uint64_t total = (uint64_t)(qps * duration);
+  for (int v = 0; v < VERDICTS; v++) results[v].latencyUs.reserve(total * (v == BLOCKED ? blockedFraction : 1 - blockedFraction) + 1000);
+  printf("Sending %llu queries at %.0f qps to %s:%u, %zu allowed and %zu blocked names, %.0f%% blocked\n",
+    (unsigned long long)total, qps, server, port, names[ALLOWED].size(), names[BLOCKED].size(), blockedFraction * 100);
+  fflush(stdout);
+
+  std::thread receiver(receiveTask, sock);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  uint8_t msg[MAX_MSG_LEN];
+  uint64_t intervalNs = (uint64_t)(1e9 / qps);
+  uint64_t start = nowNs();
+  uint64_t sendErrors = 0;
+  uint16_t id = 0;
+  for (uint64_t i = 0; i < total; i++) {
+    // open loop schedule, each query sent at its due time whatever the responses
+    uint64_t due = start + i * intervalNs;
+    int64_t wait = (int64_t)(due - nowNs());
+    if (wait > 100000) usleep(wait / 1000);
+    while ((int64_t)(due - nowNs()) > 0) {}
+
+    uint8_t verdict = uniform(rng) < blockedFraction ? BLOCKED : ALLOWED;
+    const std::string& name = names[verdict][zipfRank(cdf[verdict], uniform(rng))];
+    uint32_t pick = rng() % totalWeight;
+    uint16_t qtype = qtypeMix.back().qtype;
+    for (const QueryType& qt : qtypeMix) {
+      if (pick < qt.weight) {
+        qtype = qt.qtype;
+        break;
+      }
+      pick -= qt.weight;
+    }
+    Slot& slot = slots[++id];
+    slot.sentNs = 0; // any earlier query with this ID is unanswered after 65536 queries, so lost
+    slot.verdict = verdict;
+    int len = buildQuery(msg, id, name, qtype);
+    slot.sentNs = nowNs();
+    if (send(sock, msg, len, 0) != len) sendErrors++;
+    results[verdict].sent++;
+  }
+  uint64_t sendEnd = nowNs();
+  usleep(waitMs * 1000);
+  receiving = false;
+  receiver.join();
+
+  // report
+  double sendSecs = (sendEnd - start) / 1e9;
+  uint64_t sent = results[ALLOWED].sent + results[BLOCKED].sent;
+  uint64_t answered = results[ALLOWED].answered + results[BLOCKED].answered;
+  uint64_t lost = sent - answered;
+  double lossPct = sent ? lost * 100.0 / sent : 0;
+  printf("Achieved %.0f qps sent, %.0f qps answered, %llu lost (%.2f%%), %llu send errors\n",
+    sent / sendSecs, answered / sendSecs, (unsigned long long)lost, lossPct, (unsigned long long)sendErrors);
+  printResultsHeader("verdict");
+  double worstP99 = 0;
+  for (int v = 0; v < VERDICTS; v++) {
+    if (results[v].sent) worstP99 = std::max(worstP99, printResults(verdictNames[v], results[v]));
+  }
+
+  bool failed = false;
+  if (maxLoss >= 0 && lossPct > maxLoss) {
+    printf("FAIL: loss %.2f%% exceeds %.2f%%\n", lossPct, maxLoss);
+    failed = true;
+  }
+  if (maxP99 >= 0 && worstP99 > maxP99) {
+    printf("FAIL: p99 latency %.2f ms exceeds %.2f ms\n", worstP99, maxP99);
+    failed = true;
+  }
+  return failed ? 2 : 0;
+}
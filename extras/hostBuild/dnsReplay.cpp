@@ -0,0 +1,263 @@
+// Replays a query capture downloaded from the AdBlocker (Download query capture button),
+// against the host build or a board, with the original timing or as fast as possible,
+// so that real traffic can be used as a repeatable benchmark.
+// Reports achieved rate, loss and latency percentiles by type of answer.
+//
+// Usage: dnsReplay [options] capture.bin, see usage()
+//
+// s60sc 2026
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "dnsBench.h"
+
+// as defined in externalDNS.cpp
+#define CAPTURE_MAGIC 0x43514441
+#define CAPTURE_VERSION 1
+#define CAPTURE_TCP 0x01
+
+struct CaptureHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordLen;
+  uint32_t records;
+  uint32_t bytes;
+} __attribute__((packed));
+
+struct CaptureRecord {
+  uint32_t ms;
+  uint32_t clientIP;
+  uint16_t qtype;
+  uint8_t flags;
+  uint8_t nameLen;
+} __attribute__((packed));
+
+struct Query {
+  uint32_t ms;
+  uint32_t clientIP;
+  uint16_t qtype;
+  uint8_t flags;
+  std::string name; // wire format
+};
+
+// responses grouped by answer type, as verdict not known from capture
+enum Answer {ANS_DATA, ANS_BLOCKED, ANS_NEGATIVE, ANS_ERROR, ANSWERS};
+static const char* answerNames[ANSWERS] = {"data", "sinkhole", "negative", "error"};
+
+struct Slot {
+  std::atomic<uint64_t> sentNs; // 0 if not in flight
+};
+static Slot slots[MAX_IDS];
+static Results results[ANSWERS];
+static std::atomic<uint64_t> completed(0); // answered or given up on
+static std::atomic<bool> receiving(true);
+
+static void usage(const char* prog) {
+  printf("Usage: %s [options] capture.bin\n"
+    "  -s addr[:port]   AdBlocker address (default 127.0.0.1:5353)\n"
+    "  -x factor        speed up original timing by factor (default 1)\n"
+    "  -f               send as fast as possible, with at most -c queries in flight\n"
+    "  -c count         max queries in flight for -f (default 64)\n"
+    "  -l loops         times to replay capture (default 1)\n"
+    "  -w ms            wait for responses before counting as lost (default 2000)\n"
+    "  -p               print capture contents and exit\n", prog);
+  exit(1);
+}
+
+static std::string dottedName(const std::string& wire) {
+  std::string name;
+  size_t pos = 0;
+  while (pos < wire.size() && wire[pos]) {
+    uint8_t labelLen = wire[pos];
+    if (!name.empty()) name += '.';
+    name.append(wire, pos + 1, labelLen);
+    pos += labelLen + 1;
+  }
+  return name.empty() ? "." : name;
+}
+
+static bool loadCapture(const char* path, std::vector<Query>& queries) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) return false;
+  CaptureHeader hdr;
+  bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 && hdr.magic == CAPTURE_MAGIC && hdr.version == CAPTURE_VERSION
+    && hdr.recordLen == sizeof(CaptureRecord);
+  for (uint32_t i = 0; ok && i < hdr.records; i++) {
+    CaptureRecord rec;
+    char name[256];
+    ok = fread(&rec, sizeof(rec), 1, fp) == 1 && fread(name, rec.nameLen, 1, fp) == 1;
+    if (ok) queries.push_back({rec.ms, rec.clientIP, rec.qtype, rec.flags, std::string(name, rec.nameLen)});
+  }
+  fclose(fp);
+  if (!ok) printf("Invalid or truncated capture file %s\n", path);
+  return ok;
+}
+
+static void receiveTask(int sock) {
+  uint8_t msg[MAX_MSG_LEN * 4];
+  while (receiving) {
+    struct pollfd pfd = {sock, POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0) continue;
+    int len = recv(sock, msg, sizeof(msg), 0);
+    uint64_t now = nowNs();
+    if (len < DNS_HEADER_LEN) continue;
+    uint64_t sent = slots[(msg[0] << 8) | msg[1]].sentNs.exchange(0);
+    if (!sent) continue; // late or duplicate response
+    uint8_t rcode = msg[3] & 0x0F;
+    int answer = ANS_ERROR;
+    if (rcode == 0 && (msg[6] || msg[7])) answer = isSinkhole(msg, len) ? ANS_BLOCKED : ANS_DATA;
+    else if (rcode == 0 || rcode == RCODE_NXDOMAIN) answer = ANS_NEGATIVE;
+    Results& res = results[answer];
+    res.sent++;
+    res.answered++;
+    res.rcodes[rcode]++;
+    res.latencyUs.push_back((now - sent) / 1000);
+    completed++;
+  }
+}
+
+static void expireSlots(uint64_t now, uint64_t waitNs) {
+  // stop waiting for queries unanswered after wait time, so they no longer count as in flight
+  for (Slot& slot : slots) {
+    uint64_t sent = slot.sentNs;
+    if (sent && now - sent > waitNs && slot.sentNs.compare_exchange_strong(sent, 0)) completed++;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  char server[64] = "127.0.0.1";
+  uint16_t port = 5353;
+  double speed = 1;
+  bool fast = false, printOnly = false;
+  uint32_t window = 64, loops = 1, waitMs = 2000;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:x:fc:l:w:ph")) != -1) {
+    switch (opt) {
+      case 's': {
+        char* sep = strchr(optarg, ':');
+        if (sep != NULL) {
+          *sep = 0;
+          port = atoi(sep + 1);
+        }
+        snprintf(server, sizeof(server), "%s", optarg);
+        break;
+      }
+      case 'x': speed = atof(optarg); break;
+      case 'f': fast = true; break;
+      case 'c': window = atoi(optarg); break;
+      case 'l': loops = atoi(optarg); break;
+      case 'w': waitMs = atoi(optarg); break;
+      case 'p': printOnly = true; break;
+      default: usage(argv[0]);
+    }
+  }
+  if (optind >= argc || speed <= 0 || !window || window >= MAX_IDS) usage(argv[0]);
+  std::vector<Query> queries;
+  if (!loadCapture(argv[optind], queries)) return 1;
+  if (queries.empty()) {
+    printf("Capture is empty\n");
+    return 1;
+  }
+  uint32_t spanMs = queries.back().ms - queries.front().ms;
+  if (printOnly) {
+    for (const Query& q : queries) {
+      struct in_addr client = {q.clientIP};
+      printf("%10.3f %-15s %s %5u %s\n", (q.ms - queries.front().ms) / 1000.0, inet_ntoa(client),
+        (q.flags & CAPTURE_TCP) ? "tcp" : "udp", q.qtype, dottedName(q.name).c_str());
+    }
+    return 0;
+  }
+
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int bufSize = 4 * 1024 * 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, server, &addr.sin_addr) != 1 || connect(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+    printf("Invalid server address %s\n", server);
+    return 1;
+  }
+  printf("Replaying %zu queries captured over %.1f secs to %s:%u %s, %u times\n", queries.size(), spanMs / 1000.0,
+    server, port, fast ? "as fast as possible" : "with original timing", loops);
+  fflush(stdout);
+
+  // all queries sent from this host over UDP, so per client rate limits do not apply as captured
+  std::thread receiver(receiveTask, sock);
+  uint8_t msg[MAX_MSG_LEN];
+  uint64_t waitNs = waitMs * 1000000ULL;
+  uint64_t start = nowNs();
+  uint64_t sent = 0, sendErrors = 0;
+  uint16_t id = 0;
+  for (uint32_t loop = 0; loop < loops; loop++) {
+    uint64_t loopStart = nowNs();
+    for (const Query& q : queries) {
+      if (fast) {
+        // limit queries in flight
+        while (sent - completed >= window) {
+          uint64_t now = nowNs();
+          uint64_t oldest = slots[(uint16_t)(id - window + 1)].sentNs;
+          if (oldest && now - oldest > waitNs) expireSlots(now, waitNs);
+          else usleep(10);
+        }
+      } else {
+        uint64_t due = loopStart + (uint64_t)((q.ms - queries.front().ms) * 1e6 / speed);
+        int64_t wait = (int64_t)(due - nowNs());
+        if (wait > 100000) usleep(wait / 1000);
+        while ((int64_t)(due - nowNs()) > 0) {}
+      }
+      Slot& slot = slots[++id];
+      if (slot.sentNs.exchange(0)) completed++; // earlier query with this ID unanswered, so lost
+      memset(msg, 0, DNS_HEADER_LEN);
+      msg[0] = id >> 8;
+      msg[1] = id & 0xFF;
+      msg[2] = 0x01; // recursion desired
+      msg[5] = 1; // qdcount
+      int len = DNS_HEADER_LEN;
+      memcpy(msg + len, q.name.data(), q.name.size());
+      len += q.name.size();
+      msg[len++] = q.qtype >> 8;
+      msg[len++] = q.qtype & 0xFF;
+      msg[len++] = 0;
+      msg[len++] = 1; // class IN
+      slot.sentNs = nowNs();
+      if (send(sock, msg, len, 0) != len) sendErrors++;
+      sent++;
+    }
+  }
+  uint64_t sendEnd = nowNs();
+  usleep(waitMs * 1000);
+  receiving = false;
+  receiver.join();
+
+  // report
+  Results total;
+  for (Results& res : results) {
+    total.answered += res.answered;
+    for (int i = 0; i < 16; i++) total.rcodes[i] += res.rcodes[i];
+    total.latencyUs.insert(total.latencyUs.end(), res.latencyUs.begin(), res.latencyUs.end());
+  }
+  total.sent = sent;
+  double sendSecs = (sendEnd - start) / 1e9;
+  printf("Achieved %.0f qps sent, %.0f qps answered, %llu lost (%.2f%%), %llu send errors\n",
+    sent / sendSecs, total.answered / sendSecs, (unsigned long long)(sent - total.answered),
+    (sent - total.answered) * 100.0 / sent, (unsigned long long)sendErrors);
+  printResultsHeader("answer");
+  for (int a = 0; a < ANSWERS; a++) {
+    if (results[a].answered) printResults(answerNames[a], results[a]);
+  }
+  printResults("all", total);
+  return 0;
+}
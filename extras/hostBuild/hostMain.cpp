@@ -0,0 +1,147 @@
+// Linux host build entry point, running the AdBlocker DNS path against a local
+// blocklist file, for load testing and profiling on a PC
+//
+// Usage: adblocker [-p port] [-u upstream[:port]] [-b blocklist] [-s storage dir]
+//                  [-c key=value] [-t stats secs] [-w capture file] [-m metrics file]
+//                  [-q query log file] [-f profile file] [-v]
+//
+// s60sc 2026
+
+#include "appGlobals.h"
+#include <signal.h>
+
+void hostSetup();
+static volatile sig_atomic_t stopping = 0;
+
+static void usage(const char* prog) {
+  printf("Usage: %s [options]\n"
+    "  -p port          port for client queries (default 5353)\n"
+    "  -u addr[:port]   upstream DNS server (default 127.0.0.1:5300, see stubUpstream)\n"
+    "  -b file          blocklist file in hosts or adblock format (default blocklist.txt)\n"
+    "  -s dir           directory used as app storage for custom and hosts files (default .)\n"
+    "  -c key=value     override app config item, eg -c dnsWorkers=4, may be repeated\n"
+    "  -t secs          interval for stats output, 0 = off (default 10)\n"
+    "  -w file          on exit write query capture to file, for dnsReplay (needs -c dnsCapture=KB)\n"
+    "  -m file          on exit write metrics to file, as served at /metrics, - for stdout\n"
+    "  -q file          on exit write query log to file, as CSV or NDJSON if ending .json (needs -c dnsQueryLog=KB)\n"
+    "  -f file          on exit write task profile JSON to file, as served for Profile tab\n"
+    "  -v               verbose logging\n", prog);
+  exit(1);
+}
+
+static void loadDefaults() {
+  // apply app config defaults as if read from a fresh config file
+  char* configs = strdup(appConfig);
+  char* saveLine = NULL;
+  for (char* line = strtok_r(configs, "\n", &saveLine); line != NULL; line = strtok_r(NULL, "\n", &saveLine)) {
+    char* sep = strchr(line, '~');
+    if (sep == NULL) continue;
+    *sep = 0;
+    char* value = sep + 1;
+    sep = strchr(value, '~');
+    if (sep != NULL) *sep = 0;
+    updateStatus(line, value, false);
+  }
+  free(configs);
+}
+
+static void showStats() {
+  // output same stats as main web page
+  static const char* statItems[] = {"allowCnt", "blockCnt", "cloakCnt", "dnsLookups", "dnsFailed", "dnsLocal",
+    "dnsTcp", "dnsNs1", "dnsQueue", "dnsLimited", "topBlocked", "topAllowed", "topClients", "dnsQueryLogged", "logStats"};
+  char value[IN_FILE_NAME_LEN];
+  updateAppStatus("custom", "", false);
+  for (const char* item : statItems) {
+    if (retrieveConfigVal(item, value)) LOG_INF("%s: %s", item, value);
+  }
+}
+
+static void writeResponse(const char* path, esp_err_t (*handler)(httpd_req_t*)) {
+  // write handler response to file as if downloaded
+  FILE* fp = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+  if (fp == NULL) {
+    LOG_WRN("Cannot write file %s", path);
+    return;
+  }
+  httpd_req_t req = {fp, HTTP_GET};
+  handler(&req);
+  if (fp != stdout) fclose(fp);
+}
+
+int main(int argc, char* argv[]) {
+  char blocklist[IN_FILE_NAME_LEN] = "blocklist.txt";
+  char upstream[MAX_IP_LEN] = "127.0.0.1";
+  std::vector<std::string> overrides;
+  int statsSecs = 10;
+  const char* captureFile = NULL;
+  const char* metricsFile = NULL;
+  const char* queryLogFile = NULL;
+  const char* profileFile = NULL;
+  dnsPort = 5353;
+  dnsUpstreamPort = 5300;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:u:b:s:c:t:w:m:q:f:vh")) != -1) {
+    switch (opt) {
+      case 'p': dnsPort = atoi(optarg); break;
+      case 'u': {
+        char* port = strchr(optarg, ':');
+        if (port != NULL) {
+          *port = 0;
+          dnsUpstreamPort = atoi(port + 1);
+        }
+        snprintf(upstream, sizeof(upstream), "%s", optarg);
+        break;
+      }
+      case 'b': snprintf(blocklist, sizeof(blocklist), "%s", optarg); break;
+      case 's': LittleFS.setRoot(optarg); break;
+      case 'c': overrides.push_back(optarg); break;
+      case 't': statsSecs = atoi(optarg); break;
+      case 'w': captureFile = optarg; break;
+      case 'm': metricsFile = optarg; break;
+      case 'q': queryLogFile = optarg; break;
+      case 'f': profileFile = optarg; break;
+      case 'v': dbgVerbose = true; break;
+      default: usage(argv[0]);
+    }
+  }
+  if (access(blocklist, R_OK)) {
+    printf("Blocklist file %s not readable\n", blocklist);
+    return 1;
+  }
+
+  hostSetup();
+  loadDefaults();
+  updateStatus("fileURLc", blocklist, false);
+  strcpy(ST_ns1, upstream);
+  ST_ns2[0] = 0; // single upstream, as stub answers all names
+  for (std::string& item : overrides) {
+    size_t sep = item.find('=');
+    if (sep == std::string::npos) usage(argv[0]);
+    updateStatus(item.substr(0, sep).c_str(), item.substr(sep + 1).c_str(), false);
+  }
+
+  LOG_INF("Host build listening on port %u, upstream %s:%u", dnsPort, ST_ns1, dnsUpstreamPort);
+  signal(SIGINT, [](int) { stopping = 1; });
+  signal(SIGTERM, [](int) { stopping = 1; });
+  appSetup();
+  uint32_t lastStats = millis();
+  while (!stopping) {
+    delay(100);
+    if (statsSecs && millis() - lastStats >= statsSecs * 1000UL) {
+      showStats();
+      lastStats = millis();
+    }
+  }
+  showStats();
+  if (captureFile != NULL) writeResponse(captureFile, sendCapture);
+  if (metricsFile != NULL) writeResponse(metricsFile, metricsHandler);
+  if (profileFile != NULL) writeResponse(profileFile, sendProfile);
+  if (queryLogFile != NULL) {
+    const char* ext = strrchr(queryLogFile, '.');
+    if (ext != NULL && !strcmp(ext, ".json")) writeResponse(queryLogFile, [](httpd_req_t* req) { return sendQueryLog(req, true); });
+    else writeResponse(queryLogFile, [](httpd_req_t* req) { return sendQueryLog(req, false); });
+  }
+  delay(100); // for log output
+  return 0;
+}
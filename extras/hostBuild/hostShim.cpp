@@ -0,0 +1,661 @@
+// Linux host build shim implementation, see hostShim.h
+//
+// s60sc 2026
+
+#include "appGlobals.h"
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+
+/*********************** esp-idf ****************************/
+
+#define HOST_PSRAM_SIZE (64 * ONEMEG) // reported as largest free block, for blocklist storage
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+void* heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return HOST_PSRAM_SIZE; }
+size_t heap_caps_get_free_size(uint32_t caps) { return HOST_PSRAM_SIZE; }
+void* ps_malloc(size_t size) { return malloc(size); }
+void* ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+bool psramFound() { return true; }
+uint32_t EspClass::getFreeHeap() { return HOST_PSRAM_SIZE; }
+uint32_t EspClass::getMinFreeHeap() { return HOST_PSRAM_SIZE; }
+uint32_t EspClass::getMaxAllocHeap() { return HOST_PSRAM_SIZE; }
+uint32_t EspClass::getFreePsram() { return HOST_PSRAM_SIZE; }
+EspClass ESP;
+
+uint32_t esp_random() {
+  static thread_local std::mt19937 rng(std::random_device{}());
+  return rng();
+}
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+const char* esp_log_system_timestamp() {
+  static thread_local char timestamp[16];
+  uint32_t ms = esp_timer_get_time() / 1000;
+  snprintf(timestamp, sizeof(timestamp), "%02u:%02u:%02u.%03u", (ms / 3600000) % 24, (ms / 60000) % 60,
+    (ms / 1000) % 60, ms % 1000);
+  return timestamp;
+}
+
+const char* pathToFileName(const char* path) {
+  const char* name = strrchr(path, '/');
+  return name ? name + 1 : path;
+}
+
+void log_print_buf(const uint8_t* buf, size_t len) {
+  for (size_t i = 0; i < len; i++) printf("%02x%s", buf[i], (i % 16 == 15) ? "\n" : " ");
+  printf("\n");
+}
+
+/*********************** Arduino ****************************/
+
+// wrap as on ESP32, where unsigned long is 32 bits
+unsigned long millis() { return (uint32_t)(esp_timer_get_time() / 1000); }
+unsigned long micros() { return (uint32_t)esp_timer_get_time(); }
+void delay(uint32_t ms) { usleep(ms * 1000); }
+
+/*********************** FreeRTOS ***************************/
+
+// counting queue of fixed size items, also used for semaphores with zero item size
+struct HostQueue {
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<uint8_t> items;
+  size_t itemSize;
+  UBaseType_t length;
+  UBaseType_t count = 0;
+  UBaseType_t head = 0;
+};
+
+struct HostTask {
+  TaskFunction_t func;
+  void* arg;
+  char name[16];
+  std::mutex mtx;
+  std::condition_variable cv;
+  uint32_t notifyCount = 0;
+};
+
+static thread_local HostTask* currentTask = NULL;
+
+static bool waitFor(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, TickType_t ticks,
+  std::function<bool()> ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+void taskENTER_CRITICAL(portMUX_TYPE* mux) {
+  while (__atomic_exchange_n(&mux->lock, 1, __ATOMIC_ACQUIRE)) sched_yield();
+}
+
+void taskEXIT_CRITICAL(portMUX_TYPE* mux) {
+  __atomic_store_n(&mux->lock, 0, __ATOMIC_RELEASE);
+}
+
+static void* taskRunner(void* arg) {
+  currentTask = (HostTask*)arg;
+  currentTask->func(currentTask->arg);
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle) {
+  // stack size and priority not applied, as host threads are not constrained
+  HostTask* task = new HostTask;
+  task->func = func;
+  task->arg = arg;
+  snprintf(task->name, sizeof(task->name), "%s", name);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, taskRunner, task)) {
+    delete task;
+    return pdFALSE;
+  }
+  pthread_detach(thread);
+  if (handle != NULL) *handle = task;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  return xTaskCreate(func, name, stackSize, arg, priority, handle);
+}
+
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, BaseType_t core, UBaseType_t caps) {
+  return xTaskCreate(func, name, stackSize, arg, priority, handle);
+}
+
+BaseType_t xTaskCreateWithCaps(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, UBaseType_t caps) {
+  return xTaskCreate(func, name, stackSize, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+  // only deletion of calling task supported
+  if (handle == NULL || handle == currentTask) pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+TickType_t xTaskGetTickCount() { return millis(); }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle) { return 0; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (currentTask == NULL) {
+    // main or shim thread
+    currentTask = new HostTask;
+    snprintf(currentTask->name, sizeof(currentTask->name), "host");
+  }
+  return currentTask;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HostTask* task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mtx);
+  waitFor(lock, task->cv, ticks, [task] { return task->notifyCount > 0; });
+  uint32_t count = task->notifyCount;
+  if (count) task->notifyCount = clearOnExit ? 0 : count - 1;
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+  std::lock_guard<std::mutex> lock(handle->mtx);
+  handle->notifyCount++;
+  handle->cv.notify_one();
+  return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue* queue = new HostQueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  queue->items.resize(length * itemSize);
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mtx);
+  if (!waitFor(lock, queue->cv, ticks, [queue] { return queue->count < queue->length; })) return pdFALSE;
+  UBaseType_t tail = (queue->head + queue->count) % queue->length;
+  if (queue->itemSize) memcpy(queue->items.data() + tail * queue->itemSize, item, queue->itemSize);
+  queue->count++;
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mtx);
+  if (!waitFor(lock, queue->cv, ticks, [queue] { return queue->count > 0; })) return pdFALSE;
+  if (queue->itemSize) memcpy(item, queue->items.data() + queue->head * queue->itemSize, queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mtx);
+  return queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SemaphoreHandle_t sem = xQueueCreate(1, 0);
+  xSemaphoreGive(sem);
+  return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) { return xQueueReceive(sem, NULL, ticks); }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { return xQueueSend(sem, NULL, 0); }
+
+/*********************** AsyncUDP ***************************/
+
+#define UDP_RX_LEN 1500
+
+size_t AsyncUDPPacket::write(const uint8_t* data, size_t len) {
+  ssize_t sent = sendto(_sock, data, len, 0, (struct sockaddr*)&_from, sizeof(_from));
+  return sent < 0 ? 0 : sent;
+}
+
+bool AsyncUDP::listen(uint16_t port) {
+  sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) return false;
+  int rcvBuf = 4 * ONEMEG; // absorb load generator bursts
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    LOG_ERR("UDP bind to port %u failed: %s", port, strerror(errno));
+    close(sock);
+    sock = -1;
+    return false;
+  }
+  pthread_t thread;
+  pthread_create(&thread, NULL, receiveTask, this);
+  pthread_detach(thread);
+  return true;
+}
+
+void* AsyncUDP::receiveTask(void* arg) {
+  AsyncUDP* udp = (AsyncUDP*)arg;
+  uint8_t buf[UDP_RX_LEN];
+  while (true) {
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t len = recvfrom(udp->sock, buf, sizeof(buf), 0, (struct sockaddr*)&from, &fromLen);
+    if (len <= 0) continue;
+    AsyncUDPPacket packet(udp->sock, buf, len, from);
+    if (udp->handler) udp->handler(packet);
+  }
+  return NULL;
+}
+
+size_t AsyncUDP::writeTo(const uint8_t* data, size_t len, const IPAddress& ip, uint16_t port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)ip;
+  ssize_t sent = sendto(sock, data, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+  return sent < 0 ? 0 : sent;
+}
+
+/*********************** Storage ****************************/
+
+FS LittleFS;
+
+int File::available() {
+  if (fp == NULL) return 0;
+  int c = fgetc(fp);
+  if (c == EOF) return 0;
+  ungetc(c, fp);
+  return 1;
+}
+
+int File::read() { return fp ? fgetc(fp) : -1; }
+int File::read(uint8_t* buf, size_t len) { return fp ? fread(buf, 1, len, fp) : -1; }
+size_t File::readBytes(char* buf, size_t len) { return fp ? fread(buf, 1, len, fp) : 0; }
+
+size_t File::readBytesUntil(char terminator, char* buf, size_t len) {
+  size_t cnt = 0;
+  int c;
+  while (fp && cnt < len && (c = fgetc(fp)) != EOF && c != terminator) buf[cnt++] = c;
+  return cnt;
+}
+
+String File::readStringUntil(char terminator) {
+  std::string str;
+  int c;
+  while (fp && (c = fgetc(fp)) != EOF && c != terminator) str += (char)c;
+  return String(str);
+}
+
+size_t File::write(const uint8_t* buf, size_t len) { return fp ? fwrite(buf, 1, len, fp) : 0; }
+size_t File::print(const char* str) { return fp ? fputs(str, fp), strlen(str) : 0; }
+size_t File::println(const char* str) { return print(str) + print("\n"); }
+bool File::seek(uint32_t pos) { return fp && !fseek(fp, pos, SEEK_SET); }
+void File::flush() { if (fp) fflush(fp); }
+
+size_t File::size() {
+  struct stat st;
+  return (fp && !fstat(fileno(fp), &st)) ? st.st_size : 0;
+}
+
+void File::close() {
+  if (fp) fclose(fp);
+  fp = NULL;
+}
+
+File FS::open(const char* path, const char* mode) { return File(fopen(hostPath(path).c_str(), mode)); }
+bool FS::exists(const char* path) { return !access(hostPath(path).c_str(), F_OK); }
+bool FS::remove(const char* path) { return !::remove(hostPath(path).c_str()); }
+bool FS::mkdir(const char* path) { return !::mkdir(hostPath(path).c_str(), 0755); }
+
+/*********************** Network clients ********************/
+
+bool Client::connected() {
+  if (fp != NULL) return !feof(fp);
+  if (sock < 0) return false;
+  // closed by peer if readable with no data
+  char c;
+  return recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 0;
+}
+
+int Client::available() {
+  if (fp != NULL) return connected() ? 1 : 0;
+  int count = 0;
+  return sock >= 0 && !ioctl(sock, FIONREAD, &count) ? count : 0;
+}
+
+int Client::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int Client::read(uint8_t* buf, size_t len) {
+  // for TCP, wait up to timeout for data
+  if (fp != NULL) return fread(buf, 1, len, fp);
+  if (sock < 0) return -1;
+  struct pollfd pfd = {sock, POLLIN, 0};
+  if (poll(&pfd, 1, timeoutMs) <= 0) return -1;
+  return recv(sock, buf, len, 0);
+}
+
+size_t Client::readBytes(uint8_t* buf, size_t len) {
+  size_t cnt = 0;
+  while (cnt < len) {
+    int got = read(buf + cnt, len - cnt);
+    if (got <= 0) break;
+    cnt += got;
+  }
+  return cnt;
+}
+
+size_t Client::readBytesUntil(char terminator, uint8_t* buf, size_t len) {
+  size_t cnt = 0;
+  int c;
+  while (cnt < len && (c = read()) >= 0 && c != terminator) buf[cnt++] = c;
+  return cnt;
+}
+
+size_t Client::write(const uint8_t* buf, size_t len) {
+  size_t cnt = 0;
+  while (sock >= 0 && cnt < len) {
+    ssize_t sent = send(sock, buf + cnt, len - cnt, MSG_NOSIGNAL);
+    if (sent <= 0) break;
+    cnt += sent;
+  }
+  return cnt;
+}
+
+int Client::connect(const char* host, uint16_t port) {
+  stop();
+  struct addrinfo hints = {}, *res = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &res)) return 0;
+  sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock >= 0 && ::connect(sock, res->ai_addr, res->ai_addrlen)) stop();
+  freeaddrinfo(res);
+  if (sock < 0) return 0;
+  int noDelay = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return 1;
+}
+
+void Client::stop() {
+  if (fp) fclose(fp);
+  fp = NULL;
+  if (sock >= 0) close(sock);
+  sock = -1;
+}
+
+bool HTTPClient::begin(Client& client, const char* url) {
+  // url is http://host[:port]/path, else local file path optionally prefixed with file://
+  stream = &client;
+  headers.clear();
+  if (!strncmp(url, "http://", 7)) {
+    // connection made or reused by request
+    url += 7;
+    const char* pathStart = strchr(url, '/');
+    host.assign(url, pathStart ? pathStart - url : strlen(url));
+    path = pathStart ? pathStart : "/";
+    size_t sep = host.find(':');
+    port = sep == std::string::npos ? 80 : atoi(host.c_str() + sep + 1);
+    if (sep != std::string::npos) host.resize(sep);
+    if (client.fp) client.stop();
+    return !host.empty();
+  }
+  if (!strncmp(url, "file://", 7)) url += 7;
+  host.clear();
+  client.stop();
+  client.fp = fopen(url, "r");
+  return client.fp != NULL;
+}
+
+bool HTTPClient::readLine(std::string& line) {
+  // read header or chunk size line, without CRLF
+  line.clear();
+  int c;
+  while ((c = stream->read()) >= 0 && c != '\n') if (c != '\r') line += (char)c;
+  return c == '\n';
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t len) {
+  // send request on kept alive connection, reconnecting if closed by server, and read response headers
+  if (stream == NULL || host.empty()) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!stream->connected() && !stream->connect(host.c_str(), port)) return HTTPC_ERROR_CONNECTION_REFUSED;
+  stream->setTimeout(timeoutMs);
+  std::string request = "POST " + path + " HTTP/1.1\r\nHost: " + host + "\r\n" + headers
+    + "Content-Length: " + std::to_string(len) + "\r\n\r\n";
+  request.append((const char*)payload, len);
+  headers.clear();
+  if (stream->write((const uint8_t*)request.data(), request.size()) != request.size()) {
+    stream->stop();
+    return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+  }
+  std::string line;
+  int code = 0;
+  if (!readLine(line)) code = HTTPC_ERROR_READ_TIMEOUT;
+  else if (sscanf(line.c_str(), "HTTP/1.%*d %d", &code) != 1) code = HTTPC_ERROR_NO_HTTP_SERVER;
+  if (code < 0) {
+    stream->stop();
+    return code;
+  }
+  contentLength = -1;
+  chunked = false;
+  keepAlive = true;
+  while (readLine(line) && !line.empty()) {
+    std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+    if (!line.compare(0, 15, "content-length:")) contentLength = atoi(line.c_str() + 15);
+    else if (!line.compare(0, 18, "transfer-encoding:")) chunked = line.find("chunked") != std::string::npos;
+    else if (!line.compare(0, 11, "connection:")) keepAlive = line.find("close") == std::string::npos;
+  }
+  return code;
+}
+
+int HTTPClient::getSize() {
+  if (!host.empty()) return chunked ? -1 : contentLength;
+  struct stat st;
+  return (stream && stream->fp && !fstat(fileno(stream->fp), &st)) ? st.st_size : -1;
+}
+
+String HTTPClient::getString() {
+  // response body, decoding chunked transfer encoding
+  std::string body;
+  uint8_t buf[1024];
+  if (chunked) {
+    std::string line;
+    size_t chunkLen;
+    while (readLine(line) && (chunkLen = strtoul(line.c_str(), NULL, 16)) > 0) {
+      size_t got = stream->readBytes(buf, std::min(chunkLen, sizeof(buf)));
+      body.append((char*)buf, got);
+      if (got < chunkLen || !readLine(line)) break; // larger chunks not expected for DNS
+    }
+    readLine(line); // end of trailers
+  } else if (contentLength >= 0) {
+    size_t got = stream->readBytes(buf, std::min((size_t)contentLength, sizeof(buf)));
+    body.append((char*)buf, got);
+  } else {
+    int got;
+    while ((got = stream->read(buf, sizeof(buf))) > 0) body.append((char*)buf, got);
+    keepAlive = false;
+  }
+  return String(body);
+}
+
+void HTTPClient::end() {
+  // keep connection for reuse if response fully read
+  if (stream && (host.empty() || !keepAlive || stream->available())) stream->stop();
+}
+
+String HTTPClient::errorToString(int code) {
+  switch (code) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return String("send payload failed");
+    case HTTPC_ERROR_NOT_CONNECTED: return String("not connected");
+    case HTTPC_ERROR_NO_HTTP_SERVER: return String("no HTTP server");
+    case HTTPC_ERROR_READ_TIMEOUT: return String("read timeout");
+    default: return String("HTTP status " + std::to_string(code));
+  }
+}
+
+/*********************** Web server *************************/
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type) { return ESP_OK; }
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value) { return ESP_OK; }
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status) {
+  LOG_WRN("Response status %s", status);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t len) {
+  if (buf == NULL || !len) return ESP_OK;
+  return fwrite(buf, 1, len, (FILE*)req->handle) == (size_t)len ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* req, const char* str) {
+  return str == NULL ? ESP_OK : httpd_resp_send_chunk(req, str, strlen(str));
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t* req, const char* str) { return httpd_resp_sendstr_chunk(req, str); }
+esp_err_t httpd_resp_send_500(httpd_req_t* req) { return httpd_resp_set_status(req, "500 Internal Server Error"); }
+
+esp_err_t extractQueryKeyVal(httpd_req_t* req, char* variable, char* value) { return ESP_FAIL; }
+
+/*********************** App framework **********************/
+
+// replaces utils.cpp, utilsLog.cpp, prefs.cpp and webServer.cpp functions used by DNS path
+
+char ST_ip[MAX_IP_LEN] = "";
+char ST_sn[MAX_IP_LEN] = "";
+char ST_gw[MAX_IP_LEN] = "";
+char ST_ns1[MAX_IP_LEN] = "127.0.0.1";
+char ST_ns2[MAX_IP_LEN] = "";
+char startupFailure[SF_LEN] = {0};
+char* jsonBuff = NULL;
+bool dbgVerbose = false;
+bool useSecure = false;
+UBaseType_t STACK_MEM = MALLOC_CAP_INTERNAL;
+const char* git_rootCACertificate = "";
+
+#define HOST_LOG_BATCH 1024
+static std::map<std::string, std::string> configVect;
+static std::mutex configMtx;
+
+static void logTask(void* arg) {
+  // drain log ring to console in batches, as logTask in utilsLog.cpp
+  static char batch[HOST_LOG_BATCH];
+  while (true) {
+    logWait();
+    size_t batchLen;
+    while ((batchLen = logTakeBatch(batch, HOST_LOG_BATCH)) > 0) {
+      fwrite(batch, 1, batchLen, stdout);
+      fflush(stdout);
+    }
+  }
+}
+
+void hostSetup() {
+  // start log output before app code runs
+  logRingInit(MALLOC_CAP_SPIRAM);
+  xTaskCreate(logTask, "logTask", 0, NULL, 1, NULL);
+  jsonBuff = (char*)calloc(JSON_BUFF_LEN, 1);
+}
+
+bool updateConfigVect(const char* variable, const char* value) {
+  std::lock_guard<std::mutex> lock(configMtx);
+  configVect[variable] = value;
+  return true;
+}
+
+bool retrieveConfigVal(const char* variable, char* value) {
+  std::lock_guard<std::mutex> lock(configMtx);
+  auto it = configVect.find(variable);
+  if (it == configVect.end()) return false;
+  strcpy(value, it->second.c_str());
+  return true;
+}
+
+void updateStatus(const char* variable, const char* _value, bool fromUser) {
+  updateConfigVect(variable, _value);
+  updateAppStatus(variable, _value, fromUser);
+}
+
+char* fmtSize(uint64_t sizeVal) {
+  static thread_local char returnStr[20];
+  if (sizeVal < 50 * 1024) sprintf(returnStr, "%llu bytes", (unsigned long long)sizeVal);
+  else if (sizeVal < ONEMEG) sprintf(returnStr, "%lluKB", (unsigned long long)sizeVal / 1024);
+  else sprintf(returnStr, "%0.1fMB", (double)sizeVal / ONEMEG);
+  return returnStr;
+}
+
+char* trim(char* str) {
+  char* start = str;
+  while (isspace((unsigned char)*start)) start++;
+  char* end = start + strlen(start);
+  while (end > start && isspace((unsigned char)end[-1])) end--;
+  *end = '\0';
+  memmove(str, start, end - start + 1);
+  return str;
+}
+
+char* toCase(char* s, bool toLower) {
+  for (char* p = s; *p; p++) *p = toLower ? tolower(*p) : toupper(*p);
+  return s;
+}
+
+float smoothSensor(float latestVal, float smoothedVal, float alpha) {
+  return (latestVal * alpha) + smoothedVal * (1.0 - alpha);
+}
+
+const char* formatIPstr(bool getAP) { return "127.0.0.1"; }
+IPAddress netGatewayIP() { return IPAddress(127, 0, 0, 1); }
+bool checkAlarm() { return false; }
+void checkMemory(const char* source) {}
+uint32_t checkStackUse(TaskHandle_t thisTask, int taskIdx) { return 0; }
+
+void doRestart(const char* restartStr) {
+  LOG_ALT("Exit on restart request: %s", restartStr);
+  delay(100);
+  exit(0);
+}
+
+bool remoteServerConnect(NetworkClientSecure& client, const char* host, uint16_t port, const char* cert, uint8_t idx) {
+  // only blocklist download, from local file, supported
+  return idx == BLOCKLIST;
+}
+
+void remoteServerClose(Client& client) { client.stop(); }
+void remoteServerReset() {}
+void buildJsonString(uint8_t filter) { jsonBuff[0] = '\0'; }
+bool parseJson(int rxSize) { return false; }
+void killSocket(int skt) {}
+void stopPing() {}
+time_t getEpoch() { return time(NULL); }
+void updateLogStorageStats() {} // log only output to console
+
+const char* espErrMsg(esp_err_t errCode) {
+  static thread_local char errMsg[16];
+  snprintf(errMsg, sizeof(errMsg), "0x%x", errCode);
+  return errMsg;
+}
@@ -0,0 +1,332 @@
+// Linux host build shim, emulating the Arduino, FreeRTOS, AsyncUDP and storage APIs
+// used by the AdBlocker DNS path, so that externalDNS.cpp and appSpecific.cpp
+// can be built unchanged and load tested or profiled on a PC
+//
+// s60sc 2026
+
+#pragma once
+// app has its own timezone string, so hide libc timezone variable
+#define timezone libcTimezone
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <algorithm>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <pthread.h>
+#include <sys/stat.h>
+#undef timezone
+
+#define HOST_BUILD
+
+// esp_arduino_version.h
+#define ESP_ARDUINO_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_ARDUINO_VERSION ESP_ARDUINO_VERSION_VAL(3, 1, 1)
+#define ESP_ARDUINO_VERSION_STR "3.1.1"
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
+
+/*********************** esp-idf ****************************/
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+typedef int esp_sleep_wakeup_cause_t;
+typedef uint8_t byte;
+#define IRAM_ATTR
+#define LOG_COLOR_W ""
+#define RTC_NOINIT_ATTR
+
+#define MALLOC_CAP_INTERNAL (1 << 0)
+#define MALLOC_CAP_8BIT (1 << 1)
+#define MALLOC_CAP_SPIRAM (1 << 2)
+void* heap_caps_malloc(size_t size, uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t n, size_t size);
+bool psramFound();
+uint32_t esp_random();
+int64_t esp_timer_get_time();
+const char* esp_log_system_timestamp();
+const char* pathToFileName(const char* path);
+void log_print_buf(const uint8_t* buf, size_t len);
+
+struct EspClass {
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getFreePsram();
+};
+extern EspClass ESP;
+
+/*********************** FreeRTOS ***************************/
+
+// tasks are threads, ticks are milliseconds
+typedef unsigned int UBaseType_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) (ms)
+#define portTICK_PERIOD_MS 1
+
+struct HostTask;
+struct HostQueue;
+typedef HostTask* TaskHandle_t;
+typedef HostQueue* QueueHandle_t;
+typedef HostQueue* SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef struct {
+  volatile int lock;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void taskENTER_CRITICAL(portMUX_TYPE* mux);
+void taskEXIT_CRITICAL(portMUX_TYPE* mux);
+
+BaseType_t xTaskCreate(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, BaseType_t core, UBaseType_t caps);
+BaseType_t xTaskCreateWithCaps(TaskFunction_t func, const char* name, uint32_t stackSize, void* arg,
+  UBaseType_t priority, TaskHandle_t* handle, UBaseType_t caps);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+// freertos/atomic.h
+static inline void Atomic_Increment_u32(volatile uint32_t* val) { __atomic_fetch_add(val, 1, __ATOMIC_SEQ_CST); }
+static inline uint32_t Atomic_Decrement_u32(volatile uint32_t* val) { return __atomic_fetch_sub(val, 1, __ATOMIC_SEQ_CST); }
+static inline uint32_t Atomic_Add_u32(volatile uint32_t* val, uint32_t add) { return __atomic_fetch_add(val, add, __ATOMIC_SEQ_CST); }
+
+/*********************** Arduino ****************************/
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::min;
+using std::max;
+
+class String {
+ public:
+  String(const char* str = "") : s(str) {}
+  String(const std::string& str) : s(str) {}
+  const char* c_str() const { return s.c_str(); }
+  unsigned length() const { return s.size(); }
+  char charAt(unsigned idx) const { return s[idx]; }
+  String substring(unsigned from) const { return String(s.substr(from)); }
+  void trim() {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    size_t last = s.find_last_not_of(" \t\r\n");
+    s = (first == std::string::npos) ? "" : s.substr(first, last - first + 1);
+  }
+ private:
+  std::string s;
+};
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t o1, uint8_t o2, uint8_t o3, uint8_t o4) { octets[0] = o1; octets[1] = o2; octets[2] = o3; octets[3] = o4; }
+  IPAddress(uint32_t addr) { memcpy(octets, &addr, 4); } // network byte order
+  operator uint32_t() const { uint32_t addr; memcpy(&addr, octets, 4); return addr; }
+  uint8_t operator[](int idx) const { return octets[idx]; }
+  uint8_t& operator[](int idx) { return octets[idx]; }
+  bool operator==(const IPAddress& other) const { return !memcmp(octets, other.octets, 4); }
+  bool operator!=(const IPAddress& other) const { return memcmp(octets, other.octets, 4); }
+  bool fromString(const char* str) { return inet_pton(AF_INET, str, octets) == 1; }
+  String toString() const { char str[INET_ADDRSTRLEN]; inet_ntop(AF_INET, octets, str, sizeof(str)); return String(str); }
+ private:
+  uint8_t octets[4] = {0};
+};
+
+/*********************** AsyncUDP ***************************/
+
+// datagrams received on a POSIX UDP socket by a single receiver thread, as by the AsyncUDP task
+class AsyncUDPPacket {
+ public:
+  AsyncUDPPacket(int sock, uint8_t* data, size_t len, const struct sockaddr_in& from)
+    : _sock(sock), _data(data), _len(len), _from(from) {}
+  uint8_t* data() { return _data; }
+  size_t length() { return _len; }
+  IPAddress remoteIP() { return IPAddress((uint32_t)_from.sin_addr.s_addr); }
+  uint16_t remotePort() { return ntohs(_from.sin_port); }
+  size_t write(const uint8_t* data, size_t len);
+ private:
+  int _sock;
+  uint8_t* _data;
+  size_t _len;
+  struct sockaddr_in _from;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+ public:
+  bool listen(uint16_t port);
+  void onPacket(AuPacketHandlerFunction callback) { handler = callback; }
+  size_t writeTo(const uint8_t* data, size_t len, const IPAddress& addr, uint16_t port);
+ private:
+  static void* receiveTask(void* arg);
+  int sock = -1;
+  AuPacketHandlerFunction handler;
+};
+
+/*********************** Storage ****************************/
+
+// LittleFS paths are mapped under a host directory
+class File {
+ public:
+  File(FILE* fp = NULL) : fp(fp) {}
+  operator bool() const { return fp != NULL; }
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t len);
+  size_t readBytes(char* buf, size_t len);
+  size_t readBytesUntil(char terminator, char* buf, size_t len);
+  size_t readBytesUntil(char terminator, uint8_t* buf, size_t len) { return readBytesUntil(terminator, (char*)buf, len); }
+  String readStringUntil(char terminator);
+  size_t write(const uint8_t* buf, size_t len);
+  size_t print(const char* str);
+  size_t println(const char* str);
+  bool seek(uint32_t pos);
+  size_t size();
+  void flush();
+  void close();
+ private:
+  FILE* fp;
+};
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = FILE_READ);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool mkdir(const char* path);
+  void setRoot(const char* dir) { root = dir; }
+ private:
+  std::string hostPath(const char* path) { return root + path; }
+  std::string root = ".";
+};
+extern FS LittleFS;
+
+/*********************** Network clients ********************/
+
+// blocklist download reads a local file named by the URL, DNS over HTTPS uses plain
+// HTTP/1.1 over TCP for an http:// URL, eg to stubUpstream -w, TLS upstreams are unavailable
+class Client {
+ public:
+  virtual ~Client() { stop(); }
+  bool connected();
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t len);
+  size_t readBytes(uint8_t* buf, size_t len);
+  size_t readBytesUntil(char terminator, uint8_t* buf, size_t len);
+  size_t write(const uint8_t* buf, size_t len);
+  int connect(const char* host, uint16_t port);
+  void setTimeout(uint32_t ms) { timeoutMs = ms; }
+  void stop();
+  FILE* fp = NULL; // local file
+  int sock = -1; // TCP connection
+  uint32_t timeoutMs = 1000;
+};
+class WiFiClient : public Client {};
+typedef WiFiClient NetworkClient;
+class NetworkClientSecure : public WiFiClient {
+ public:
+  int lastError(char* buf, size_t len) { snprintf(buf, len, "not supported in host build"); return -1; }
+  void setInsecure() {}
+  void setCACert(const char* cert) {}
+  void setHandshakeTimeout(unsigned long secs) {}
+  int connect(const char* host, uint16_t port, int32_t timeout) { return 0; }
+};
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_MOVED_PERMANENTLY 301
+#define HTTPC_ERROR_CONNECTION_REFUSED -1
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED -3
+#define HTTPC_ERROR_NOT_CONNECTED -4
+#define HTTPC_ERROR_NO_HTTP_SERVER -7
+#define HTTPC_ERROR_READ_TIMEOUT -11
+class HTTPClient {
+ public:
+  bool begin(Client& client, const char* url);
+  int GET() { return stream && stream->fp ? HTTP_CODE_OK : -1; }
+  int POST(uint8_t* payload, size_t len);
+  int getSize();
+  String getString();
+  WiFiClient* getStreamPtr() { return (WiFiClient*)stream; }
+  bool connected() { return stream && stream->connected(); }
+  void end();
+  String errorToString(int code);
+  void addHeader(const char* name, const char* value) { headers = headers + name + ": " + value + "\r\n"; }
+  void setReuse(bool reuse) {}
+  void setTimeout(uint16_t ms) { timeoutMs = ms; }
+  void setConnectTimeout(int32_t ms) {}
+ private:
+  bool readLine(std::string& line);
+  Client* stream = NULL;
+  std::string host, path, headers; // host empty for local file
+  uint16_t port = 80;
+  uint32_t timeoutMs = 5000;
+  int contentLength = -1; // -1 if chunked or ended by close
+  bool chunked = false;
+  bool keepAlive = true;
+};
+
+/*********************** Web server *************************/
+
+// responses written to file given as handle
+enum http_method {HTTP_DELETE, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT};
+typedef struct {
+  void* handle;
+  int method;
+} httpd_req_t;
+typedef void* httpd_handle_t;
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value);
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t len);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* req, const char* str);
+esp_err_t httpd_resp_sendstr(httpd_req_t* req, const char* str);
+esp_err_t httpd_resp_send_500(httpd_req_t* req);
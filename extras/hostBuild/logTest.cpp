@@ -0,0 +1,64 @@
+// Host test of deferred logging, checking that each record formatted by logTask
+// matches the text LOG_SEND would have produced when called
+//
+// Usage: logTest, exits with failure if any record differs
+//
+// s60sc 2026
+
+#include "appGlobals.h"
+
+static int failures = 0;
+
+// app config not used, as only the log ring is linked
+bool updateAppStatus(const char* variable, const char* value, bool fromUser) { return false; }
+
+static void expect(const char* expected) {
+  // format next record in ring and compare message text, after the prefix
+  char batch[MAX_OUT * 2];
+  size_t batchLen = logTakeBatch(batch, sizeof(batch));
+  const char* msg = strstr(batch, "] ");
+  msg = msg ? msg + 2 : batch;
+  size_t len = strlen(expected);
+  bool ok = batchLen && !strncmp(msg, expected, len) && msg[len] && strchr("~\033", msg[len]);
+  if (!ok) failures++;
+  printf("%s: expected '%s', got '%.*s'\n", ok ? "pass" : "FAIL", expected, (int)strcspn(msg, "~\033\n"), msg);
+}
+
+int main() {
+  logRingInit(MALLOC_CAP_SPIRAM);
+  char expected[MAX_OUT];
+
+  // binary buffer not terminated, must be logged as pointer value, not read as string
+  uint8_t* data = (uint8_t*)malloc(4);
+  memset(data, 'x', 4);
+  unsigned len = 0;
+  LOG_WRN("Invalid data or length: data=%p, len=%u", data, len);
+  snprintf(expected, sizeof(expected), "Invalid data or length: data=%p, len=%u", data, len);
+  expect(expected);
+  const int8_t* sdata = (const int8_t*)data;
+  LOG_WRN("Signed data=%p", sdata);
+  snprintf(expected, sizeof(expected), "Signed data=%p", sdata);
+  expect(expected);
+  uint8_t* none = NULL;
+  LOG_WRN("No data=%p", none);
+  snprintf(expected, sizeof(expected), "No data=%p", none);
+  expect(expected);
+  free(data);
+
+  // strings copied, other types by value
+  char name[] = "test.example";
+  const char* literal = "literal";
+  LOG_WRN("%s and %s", name, literal);
+  expect("test.example and literal");
+  const char* nullStr = NULL;
+  LOG_WRN("Null %s", nullStr);
+  expect("Null (null)");
+  LOG_WRN("%d %u %lu %llu %x %c", -5, 7u, 123456UL, 1ULL << 40, 0xABu, 'Z');
+  snprintf(expected, sizeof(expected), "%d %u %lu %llu %x %c", -5, 7u, 123456UL, 1ULL << 40, 0xABu, 'Z');
+  expect(expected);
+  LOG_WRN("%.2f %5s|%-4d|%*d %%", 3.14159, "ab", 12, 6, 42);
+  expect("3.14    ab|12  |    42 %");
+
+  printf("%s\n", failures ? "logTest failed" : "logTest passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,334 @@
+// Stub upstream DNS server for host build load testing, so that results are not
+// distorted by internet latency or upstream rate limits.
+// Answers every A query with a 198.18.x.x address and AAAA with 2001:db8::x derived
+// from the name, names ending .invalid with NXDOMAIN, other types with NODATA.
+// With -n, names ending .cloak are answered with a CNAME to the given target, eg a
+// blocklisted name, followed by its address, to test detection of CNAME cloaking.
+// Optionally also a DNS over HTTPS stand-in, taking RFC 8484 POST requests over plain
+// HTTP/1.1 keep-alive connections, for the AdBlocker with an http:// DNS over HTTPS URL.
+//
+// Usage: stubUpstream [-p port] [-d delay ms] [-t ttl secs] [-w DoH port] [-c] [-n CNAME target]
+//
+// s60sc 2026
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define DNS_HEADER_LEN 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define RCODE_NXDOMAIN 3
+#define MAX_MSG_LEN 512
+#define MAX_HTTP_CONNS 8
+#define MAX_HTTP_REQ 4096 // headers and body
+#define MAX_TARGET_LEN 100 // so that response fits in MAX_MSG_LEN
+
+struct Delayed {
+  uint64_t due; // ms
+  struct sockaddr_in to;
+  std::vector<uint8_t> msg;
+};
+
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint32_t fnvHash(const uint8_t* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) hash = (hash ^ (data[i] | 0x20)) * 16777619u; // case insensitive
+  return hash;
+}
+
+static uint8_t cloakTarget[MAX_TARGET_LEN + 2]; // as DNS labels
+static int cloakLen = 0;
+
+static void put16(uint8_t* p, uint16_t val) { p[0] = val >> 8; p[1] = val & 0xFF; }
+static void put32(uint8_t* p, uint32_t val) { put16(p, val >> 16); put16(p + 2, val & 0xFFFF); }
+
+static int buildResponse(uint8_t* msg, int len, uint32_t ttl) {
+  // convert query in msg to response in place, return response length or 0 to ignore
+  if (len < DNS_HEADER_LEN + 5 || (msg[2] & 0x80)) return 0; // not a query
+  int pos = DNS_HEADER_LEN;
+  int lastLabel = 0;
+  while (pos < len && msg[pos]) {
+    if (msg[pos] & 0xC0) return 0; // no compression in question
+    lastLabel = pos;
+    pos += msg[pos] + 1;
+  }
+  if (pos + 5 > len) return 0;
+  int nameLen = pos + 1 - DNS_HEADER_LEN;
+  uint16_t qtype = (msg[pos + 1] << 8) | msg[pos + 2];
+  int qEnd = pos + 5;
+  bool nxdomain = lastLabel && msg[lastLabel] == 7 && !strncasecmp((char*)msg + lastLabel + 1, "invalid", 7);
+  bool cloak = cloakLen && lastLabel && msg[lastLabel] == 5 && !strncasecmp((char*)msg + lastLabel + 1, "cloak", 5);
+
+  // header: response, recursion available, question only so far, drop any additional (EDNS)
+  msg[2] = 0x80 | (msg[2] & 0x01);
+  msg[3] = 0x80 | (nxdomain ? RCODE_NXDOMAIN : 0);
+  put16(msg + 6, 0);
+  put16(msg + 8, 0);
+  put16(msg + 10, 0);
+  uint8_t* p = msg + qEnd;
+  uint32_t hash = fnvHash(msg + DNS_HEADER_LEN, nameLen);
+
+  if (!nxdomain && (qtype == DNS_TYPE_A || qtype == DNS_TYPE_AAAA)) {
+    uint16_t owner = 0xC000 | DNS_HEADER_LEN; // pointer to question name
+    if (cloak) {
+      // CNAME to target, then address of target
+      put16(p, owner);
+      put16(p + 2, DNS_TYPE_CNAME);
+      put16(p + 4, DNS_CLASS_IN);
+      put32(p + 6, ttl);
+      put16(p + 10, cloakLen);
+      memcpy(p + 12, cloakTarget, cloakLen);
+      owner = 0xC000 | (p + 12 - msg);
+      p += 12 + cloakLen;
+    }
+    put16(msg + 6, cloak ? 2 : 1);
+    put16(p, owner);
+    put16(p + 2, qtype);
+    put16(p + 4, DNS_CLASS_IN);
+    put32(p + 6, ttl);
+    if (qtype == DNS_TYPE_A) {
+      put16(p + 10, 4);
+      p[12] = 198;
+      p[13] = 18 + (hash & 1);
+      p[14] = (hash >> 8) & 0xFF;
+      p[15] = (hash >> 16) & 0xFF;
+      p += 16;
+    } else {
+      put16(p + 10, 16);
+      memset(p + 12, 0, 16);
+      put16(p + 12, 0x2001);
+      put16(p + 14, 0x0db8);
+      put32(p + 24, hash);
+      p += 28;
+    }
+  } else {
+    // NXDOMAIN or NODATA, with SOA in authority section for negative caching
+    put16(msg + 8, 1);
+    put16(p, 0xC000 | DNS_HEADER_LEN);
+    put16(p + 2, DNS_TYPE_SOA);
+    put16(p + 4, DNS_CLASS_IN);
+    put32(p + 6, ttl);
+    static const uint8_t soaData[] = {
+      2, 'n', 's', 0, // mname
+      4, 'h', 'o', 's', 't', 0, // rname
+      0, 0, 0, 1, // serial
+      0, 0, 0x0E, 0x10, // refresh
+      0, 0, 0x02, 0x58, // retry
+      0, 0x09, 0x3A, 0x80, // expire
+      0, 0, 0, 0}; // minimum, set below
+    put16(p + 10, sizeof(soaData));
+    memcpy(p + 12, soaData, sizeof(soaData));
+    put32(p + 12 + sizeof(soaData) - 4, ttl);
+    p += 12 + sizeof(soaData);
+  }
+  return p - msg;
+}
+
+struct HttpConn {
+  int sock;
+  std::string rx; // partially received request
+};
+
+static bool sendAll(int sock, const char* data, size_t len) {
+  while (len) {
+    ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+    if (sent <= 0) return false;
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+static bool httpRequest(HttpConn& conn, uint32_t ttl, bool chunked) {
+  // answer each complete request received, return false if connection to be closed
+  while (true) {
+    size_t hdrEnd = conn.rx.find("\r\n\r\n");
+    if (hdrEnd == std::string::npos) return conn.rx.size() < MAX_HTTP_REQ;
+    std::string hdrs = conn.rx.substr(0, hdrEnd);
+    for (char& c : hdrs) c = tolower(c);
+    size_t lenPos = hdrs.find("\r\ncontent-length:");
+    size_t bodyLen = lenPos == std::string::npos ? 0 : atoi(hdrs.c_str() + lenPos + 17);
+    if (conn.rx.size() < hdrEnd + 4 + bodyLen) return bodyLen <= MAX_MSG_LEN - 64;
+    uint8_t msg[MAX_MSG_LEN];
+    int len = 0;
+    if (!hdrs.compare(0, 5, "post ") && hdrs.find("application/dns-message") != std::string::npos
+      && bodyLen <= MAX_MSG_LEN - 64) {
+      memcpy(msg, conn.rx.data() + hdrEnd + 4, bodyLen);
+      len = buildResponse(msg, bodyLen, ttl);
+    }
+    conn.rx.erase(0, hdrEnd + 4 + bodyLen);
+    char head[256];
+    if (!len) {
+      snprintf(head, sizeof(head), "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n");
+      if (!sendAll(conn.sock, head, strlen(head))) return false;
+      continue;
+    }
+    // chunked response has no Content-Length, and is sent in two chunks
+    if (chunked) {
+      int half = len / 2;
+      snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: application/dns-message\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n%x\r\n", half);
+      std::string rsp = head;
+      rsp.append((char*)msg, half);
+      snprintf(head, sizeof(head), "\r\n%x\r\n", len - half);
+      rsp += head;
+      rsp.append((char*)msg + half, len - half);
+      rsp += "\r\n0\r\n\r\n";
+      if (!sendAll(conn.sock, rsp.data(), rsp.size())) return false;
+    } else {
+      snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: application/dns-message\r\n"
+        "Content-Length: %d\r\n\r\n", len);
+      std::string rsp = head;
+      rsp.append((char*)msg, len);
+      if (!sendAll(conn.sock, rsp.data(), rsp.size())) return false;
+    }
+  }
+}
+
+static int httpListen(uint16_t port) {
+  int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  int reuse = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 4) < 0) {
+    perror("DoH bind");
+    exit(1);
+  }
+  return sock;
+}
+
+static void usage(const char* prog) {
+  printf("Usage: %s [options]\n"
+    "  -p port          port for UDP queries (default 5300)\n"
+    "  -d ms            delay before each UDP response (default 0)\n"
+    "  -t secs          ttl of answers (default 300)\n"
+    "  -w port          also serve DNS over HTTPS stand-in as plain HTTP on port, eg 8053\n"
+    "  -c               send DNS over HTTPS responses chunked, without Content-Length\n"
+    "  -n name          answer names ending .cloak with a CNAME to name\n", prog);
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  uint16_t port = 5300;
+  uint32_t delayMs = 0;
+  uint32_t ttl = 300;
+  uint16_t dohPort = 0;
+  bool chunked = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:d:t:w:cn:h")) != -1) {
+    switch (opt) {
+      case 'p': port = atoi(optarg); break;
+      case 'd': delayMs = atoi(optarg); break;
+      case 't': ttl = atoi(optarg); break;
+      case 'w': dohPort = atoi(optarg); break;
+      case 'c': chunked = true; break;
+      case 'n': {
+        // encode as labels
+        if (strlen(optarg) > MAX_TARGET_LEN) usage(argv[0]);
+        char* save;
+        for (char* label = strtok_r(optarg, ".", &save); label; label = strtok_r(NULL, ".", &save)) {
+          int labelLen = strlen(label);
+          if (labelLen > 63) usage(argv[0]);
+          cloakTarget[cloakLen++] = labelLen;
+          memcpy(cloakTarget + cloakLen, label, labelLen);
+          cloakLen += labelLen;
+        }
+        cloakTarget[cloakLen++] = 0;
+        break;
+      }
+      default: usage(argv[0]);
+    }
+  }
+
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int bufSize = 4 * 1024 * 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    return 1;
+  }
+  printf("Stub upstream on 127.0.0.1:%u, delay %lu ms, ttl %lu secs\n", port, (unsigned long)delayMs, (unsigned long)ttl);
+  int httpSock = dohPort ? httpListen(dohPort) : -1;
+  if (dohPort) printf("DNS over HTTPS stand-in at http://127.0.0.1:%u/dns-query%s\n", dohPort, chunked ? ", chunked" : "");
+  fflush(stdout);
+  std::vector<HttpConn> conns;
+
+  // responses held in due time order, as delay is fixed
+  std::deque<Delayed> delayed;
+  uint8_t msg[MAX_MSG_LEN];
+  uint64_t served = 0;
+  while (true) {
+    int timeout = -1;
+    if (!delayed.empty()) {
+      int64_t wait = (int64_t)(delayed.front().due - nowMs());
+      timeout = wait > 0 ? wait : 0;
+    }
+    // UDP socket, then DoH listener and connections if enabled
+    std::vector<struct pollfd> pfds = {{sock, POLLIN, 0}};
+    if (httpSock >= 0) pfds.push_back({httpSock, POLLIN, 0});
+    for (HttpConn& conn : conns) pfds.push_back({conn.sock, POLLIN, 0});
+    if (poll(pfds.data(), pfds.size(), timeout) <= 0) pfds[0].revents = 0;
+    if (httpSock >= 0) {
+      for (size_t i = conns.size(); i-- > 0;) {
+        if (!pfds[i + 2].revents) continue;
+        char buf[2048];
+        ssize_t got = recv(conns[i].sock, buf, sizeof(buf), 0);
+        if (got > 0) conns[i].rx.append(buf, got);
+        if (got <= 0 || !httpRequest(conns[i], ttl, chunked)) {
+          close(conns[i].sock);
+          conns.erase(conns.begin() + i);
+        }
+      }
+      if (pfds[1].revents) {
+        int conn = accept(httpSock, NULL, NULL);
+        if (conn >= 0 && conns.size() < MAX_HTTP_CONNS) conns.push_back({conn, ""});
+        else if (conn >= 0) close(conn);
+      }
+    }
+    if (pfds[0].revents) {
+      struct sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      int len = recvfrom(sock, msg, sizeof(msg) - 64, 0, (struct sockaddr*)&from, &fromLen);
+      if (len > 0 && (len = buildResponse(msg, len, ttl)) > 0) {
+        if (delayMs) delayed.push_back({nowMs() + delayMs, from, std::vector<uint8_t>(msg, msg + len)});
+        else sendto(sock, msg, len, 0, (struct sockaddr*)&from, fromLen);
+        served++;
+      }
+    }
+    uint64_t now = nowMs();
+    while (!delayed.empty() && delayed.front().due <= now) {
+      Delayed& d = delayed.front();
+      sendto(sock, d.msg.data(), d.msg.size(), 0, (struct sockaddr*)&d.to, sizeof(d.to));
+      delayed.pop_front();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,317 @@
+// Lock-free multi-producer log ring
+//
+// Log messages are written by any task as variable length records into a byte ring,
+// and drained in batches by logTask, so that each output (web socket, console,
+// RAM log, SD) is written once per batch rather than once per message.
+// A producer claims space for its record by advancing the ring head with a compare
+// and swap, fills in the record, then commits it by setting its header word.
+// logTask is the only consumer, taking committed records in order from the tail,
+// and clearing their space before releasing it back to producers.
+// If the ring is full, the message is dropped and counted rather than waiting.
+//
+// Info, alert, warning and verbose messages are stored as deferred records,
+// with the arguments packed as given, and formatted as text by logTask.
+//
+// s60sc 2026
+
+#include "appGlobals.h"
+#include "freertos/atomic.h"
+
+#define LOG_RING_LEN (1024 * 8) // bytes, power of 2
+#define LOG_REC_HDR sizeof(uint32_t) // header word: record length and state, 0 until committed
+#define LOG_REC_LEN 0xFFFF
+#define LOG_REC_READY 0x10000
+#define LOG_REC_PAD 0x20000 // skip to start of ring, as record would not fit at end
+#define LOG_WAIT_TICKS pdMS_TO_TICKS(1000) // fallback if wakeup missed
+
+static char* logRing = NULL;
+static uint32_t ringHead = 0; // bytes claimed by producers, wraps at 2^32
+static uint32_t ringTail = 0; // bytes released by consumer
+static TaskHandle_t logConsumer = NULL;
+static uint32_t consumerWaiting = 0;
+static logStats_t logStats = {0, 0, 0, 0, 0, LOG_RING_LEN};
+
+bool logRingInit(uint32_t caps) {
+  // allocate ring, zeroed as uncommitted
+  if (logRing == NULL) logRing = (char*)heap_caps_malloc(LOG_RING_LEN, caps);
+  if (logRing != NULL) memset(logRing, 0, LOG_RING_LEN);
+  return logRing != NULL;
+}
+
+void logIncrementDropCount(void) {
+  Atomic_Increment_u32(&logStats.dropped);
+}
+
+static inline uint32_t recordSpan(size_t len) {
+  return (len + LOG_REC_HDR + 3) & ~3; // word aligned
+}
+
+static char* logReserve(size_t len) {
+  // claim contiguous space in ring for record of len bytes
+  if (logRing == NULL) {
+    logIncrementDropCount();
+    return NULL;
+  }
+  uint32_t need = recordSpan(len);
+  uint32_t head = __atomic_load_n(&ringHead, __ATOMIC_RELAXED);
+  uint32_t offset, pad, used;
+  do {
+    offset = head & (LOG_RING_LEN - 1);
+    pad = offset + need > LOG_RING_LEN ? LOG_RING_LEN - offset : 0;
+    used = head + pad + need - __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE);
+    if (used > LOG_RING_LEN) {
+      logIncrementDropCount();
+      return NULL;
+    }
+  } while (!__atomic_compare_exchange_n(&ringHead, &head, head + pad + need, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  if (used > logStats.peakUsed) logStats.peakUsed = used; // approximate, not worth contending for
+  if (pad) {
+    __atomic_store_n((uint32_t*)(logRing + offset), pad | LOG_REC_PAD | LOG_REC_READY, __ATOMIC_RELEASE);
+    offset = 0;
+  }
+  return logRing + offset + LOG_REC_HDR;
+}
+
+static void logCommit(char* rec, size_t len) {
+  // mark record as ready, and wake logTask if waiting for it
+  __atomic_store_n((uint32_t*)(rec - LOG_REC_HDR), recordSpan(len) | LOG_REC_READY, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&consumerWaiting, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&consumerWaiting, 0, __ATOMIC_SEQ_CST)) 
+    xTaskNotifyGive(logConsumer);
+}
+
+int logSendV(const char* format, va_list args) {
+  // format text record directly into ring
+  va_list sizeArgs;
+  va_copy(sizeArgs, args);
+  int len = vsnprintf(NULL, 0, format, sizeArgs) + 1;
+  va_end(sizeArgs);
+  if (len > MAX_OUT) len = MAX_OUT;
+  char* rec = logReserve(len);
+  if (rec != NULL) {
+    vsnprintf(rec, len, format, args);
+    if (len == MAX_OUT) rec[MAX_OUT - 2] = '\n'; // truncated, ensure ending newline
+    logCommit(rec, len);
+  }
+  return len - 1;
+}
+
+void logSend(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  logSendV(format, args);
+  va_end(args);
+}
+
+#if LOG_DEFERRED
+
+/************************ Deferred formatting ************************/
+
+bool logDeferBegin(logPacker* pk, uint8_t kind, const char* func, const char* format, size_t len) {
+  // claim ring space and write record header
+  if (len > MAX_OUT) len = MAX_OUT; // later arguments truncated or dropped
+  pk->buf = logReserve(len);
+  if (pk->buf == NULL) return false;
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  logRecord hdr = {LOG_DEFER_MARK, kind, (uint16_t)(tv.tv_usec / 1000), (uint32_t)tv.tv_sec, func, format};
+  memcpy(pk->buf, &hdr, sizeof(hdr));
+  pk->pos = pk->buf + sizeof(hdr);
+  pk->end = pk->buf + len - 1; // room for LOG_ARG_END
+  return true;
+}
+
+static void logPackValue(logPacker* pk, uint8_t type, const void* val, size_t len) {
+  // if no room, later arguments are also dropped, shown as ?
+  if (pk->pos + 1 + len > pk->end) pk->pos = pk->end;
+  else {
+    *pk->pos++ = type;
+    memcpy(pk->pos, val, len);
+    pk->pos += len;
+  }
+}
+
+void logPackInt(logPacker* pk, long long val) {
+  logPackValue(pk, LOG_ARG_INT, &val, sizeof(val));
+}
+
+void logPackDouble(logPacker* pk, double val) {
+  logPackValue(pk, LOG_ARG_DBL, &val, sizeof(val));
+}
+
+void logPackStr(logPacker* pk, const char* str) {
+  // copy string, truncated to fit
+  if (str == NULL) str = "(null)";
+  int room = pk->end - pk->pos - 2; // type and terminator
+  if (room < 0) return;
+  size_t len = strnlen(str, room);
+  *pk->pos++ = LOG_ARG_STR;
+  memcpy(pk->pos, str, len);
+  pk->pos += len;
+  *pk->pos++ = 0;
+}
+
+void logDeferEnd(logPacker* pk) {
+  *pk->pos = LOG_ARG_END;
+  logCommit(pk->buf, pk->end + 1 - pk->buf);
+}
+
+void logFormatCheck(const char* format, ...) {}
+
+static int formatLogArg(char* out, int outLen, const char* spec, const char*& arg) {
+  // format next argument using single conversion spec, with type given by spec
+  char conv = spec[strlen(spec) - 1];
+  uint8_t type = *arg;
+  long long intVal = 0;
+  double dblVal = 0;
+  const char* strVal = NULL;
+  if (type == LOG_ARG_INT) memcpy(&intVal, arg + 1, sizeof(intVal));
+  else if (type == LOG_ARG_DBL) memcpy(&dblVal, arg + 1, sizeof(dblVal));
+  else if (type == LOG_ARG_STR) strVal = arg + 1;
+  if (type == LOG_ARG_STR) arg += strlen(strVal) + 2;
+  else if (type != LOG_ARG_END) arg += 1 + sizeof(long long);
+  bool isLL = strstr(spec, "ll") != NULL || strchr(spec, 'j') != NULL;
+  bool isL = !isLL && strchr(spec, 'l') != NULL;
+  bool isZ = strchr(spec, 'z') != NULL;
+  switch (conv) {
+    case 'd': case 'i':
+      if (type != LOG_ARG_INT) break;
+      if (isLL) return snprintf(out, outLen, spec, intVal);
+      if (isL) return snprintf(out, outLen, spec, (long)intVal);
+      if (isZ) return snprintf(out, outLen, spec, (ssize_t)intVal);
+      return snprintf(out, outLen, spec, (int)intVal);
+    case 'u': case 'x': case 'X': case 'o':
+      if (type != LOG_ARG_INT) break;
+      if (isLL) return snprintf(out, outLen, spec, (unsigned long long)intVal);
+      if (isL) return snprintf(out, outLen, spec, (unsigned long)intVal);
+      if (isZ) return snprintf(out, outLen, spec, (size_t)intVal);
+      return snprintf(out, outLen, spec, (unsigned)intVal);
+    case 'c':
+      if (type == LOG_ARG_INT) return snprintf(out, outLen, spec, (int)intVal);
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+      if (type == LOG_ARG_DBL) return snprintf(out, outLen, spec, dblVal);
+      break;
+    case 's':
+      if (type == LOG_ARG_STR) return snprintf(out, outLen, spec, strVal);
+      break;
+    case 'p':
+      if (type == LOG_ARG_INT) return snprintf(out, outLen, spec, (void*)(uintptr_t)intVal);
+      break;
+  }
+  return snprintf(out, outLen, "?"); // missing or mismatched argument
+}
+
+static void formatLogRecord(const char* rec, char* out, int outLen) {
+  // format deferred record as text, as LOG_SEND would have when called
+  static const char* prefixes[] = {LOG_PFX_INF, LOG_PFX_ALT, LOG_PFX_WRN, LOG_PFX_VRB};
+  static const char* suffixes[] = {LOG_SFX_INF, LOG_SFX_ALT, LOG_SFX_WRN, LOG_SFX_VRB};
+  logRecord hdr;
+  memcpy(&hdr, rec, sizeof(hdr));
+  time_t secs = hdr.secs;
+  struct tm timeinfo;
+  localtime_r(&secs, &timeinfo);
+  char timeStr[16];
+  snprintf(timeStr, sizeof(timeStr), "%02d:%02d:%02d.%03u", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, hdr.ms);
+  int suffixLen = strlen(suffixes[hdr.kind]);
+  int maxPos = outLen - suffixLen - 1;
+  int pos = min(snprintf(out, outLen, prefixes[hdr.kind], timeStr, hdr.func), maxPos);
+  const char* arg = rec + sizeof(hdr);
+  const char* f = hdr.format;
+  while (*f && pos < maxPos) {
+    if (*f != '%') out[pos++] = *f++;
+    else if (f[1] == '%') {
+      out[pos++] = '%';
+      f += 2;
+    } else {
+      // isolate conversion spec, replacing any * with its argument
+      char spec[24];
+      int sLen = 0;
+      spec[sLen++] = *f++;
+      while (*f && strchr("-+ #0123456789.*hlLzjt", *f) && sLen < (int)sizeof(spec) - 12) {
+        if (*f == '*') {
+          long long starVal = 0;
+          if (*arg == LOG_ARG_INT) {
+            memcpy(&starVal, arg + 1, sizeof(starVal));
+            arg += 1 + sizeof(starVal);
+          }
+          sLen += sprintf(spec + sLen, "%d", (int)starVal);
+          f++;
+        } else spec[sLen++] = *f++;
+      }
+      if (*f) spec[sLen++] = *f++;
+      spec[sLen] = 0;
+      pos += formatLogArg(out + pos, maxPos - pos + 1, spec, arg);
+      pos = min(pos, maxPos);
+    }
+  }
+  strcpy(out + pos, suffixes[hdr.kind]);
+}
+
+#endif
+
+/************************ Consumer ************************/
+
+void logWait() {
+  // called by logTask to wait for next record
+  // producers only notify when flagged as waiting, so check again after flagging
+  logConsumer = xTaskGetCurrentTaskHandle();
+  __atomic_store_n(&consumerWaiting, 1, __ATOMIC_SEQ_CST);
+  uint32_t* hdr = (uint32_t*)(logRing + (ringTail & (LOG_RING_LEN - 1)));
+  if (logRing == NULL || !__atomic_load_n(hdr, __ATOMIC_SEQ_CST)) ulTaskNotifyTake(pdTRUE, LOG_WAIT_TICKS);
+  __atomic_store_n(&consumerWaiting, 0, __ATOMIC_SEQ_CST);
+}
+
+bool logDrained() {
+  // true when logTask has output every record claimed so far and is waiting for more
+  return __atomic_load_n(&consumerWaiting, __ATOMIC_SEQ_CST)
+    && __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE) == __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE);
+}
+
+size_t logTakeBatch(char* batch, size_t batchLen) {
+  // append committed messages in order as text to batch, while room for longest message
+  size_t used = 0;
+  while (logRing != NULL && batchLen - used > MAX_OUT) {
+    uint32_t offset = ringTail & (LOG_RING_LEN - 1);
+    uint32_t hdr = __atomic_load_n((uint32_t*)(logRing + offset), __ATOMIC_ACQUIRE);
+    if (!hdr) break; // none ready, or next still being written
+    const char* rec = logRing + offset + LOG_REC_HDR;
+    if (!(hdr & LOG_REC_PAD)) {
+#if LOG_DEFERRED
+      if (*rec == LOG_DEFER_MARK) formatLogRecord(rec, batch + used, MAX_OUT);
+      else
+#endif
+      strncpy(batch + used, rec, MAX_OUT);
+      batch[used + MAX_OUT - 1] = 0;
+      size_t msgLen = strlen(batch + used);
+      used += msgLen;
+      logStats.messages++;
+      logStats.bytes += msgLen;
+    }
+    // clear record space before release, so producers find uncommitted headers
+    uint32_t span = hdr & LOG_REC_LEN;
+    memset(logRing + offset, 0, span);
+    __atomic_store_n(&ringTail, ringTail + span, __ATOMIC_RELEASE);
+  }
+  batch[used] = 0;
+  if (used) logStats.batches++;
+  return used;
+}
+
+void getLogStats(logStats_t* stats) {
+  *stats = logStats;
+}
+
+void updateLogStats() {
+  // format log throughput since last call for display on web page
+  static uint32_t lastMs = 0, lastMessages = 0, lastBatches = 0;
+  uint32_t elapsed = millis() - lastMs;
+  if (!elapsed) return;
+  char statsStr[FILE_NAME_LEN];
+  snprintf(statsStr, sizeof(statsStr), "%lu/s in %lu/s batches, peak %lu%%, drops %lu", 
+    (logStats.messages - lastMessages) * 1000UL / elapsed, (logStats.batches - lastBatches) * 1000UL / elapsed,
+    logStats.peakUsed * 100 / LOG_RING_LEN, logStats.dropped);
+  updateConfigVect("logStats", statsStr);
+  lastMs += elapsed;
+  lastMessages = logStats.messages;
+  lastBatches = logStats.batches;
+}